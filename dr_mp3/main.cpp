@@ -4,11 +4,891 @@
 #include <cstdio>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PCM_HAS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PCM_TARGET_AVX2
+#else
+#define PCM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 /// You can find the dr_mp3 library at the link below: 
 ///
 /// https://github.com/mackron/dr_libs
 
+/// dr_mp3 can give us the frames as `short`s or `float`s. However, the mixer 
+/// on the other end usually wants one specific format, and converting between them 
+/// sample by sample on the audio thread adds up quickly. 
+///
+/// Below is a small set of conversion and (de)interleaving kernels. Each one comes in 
+/// three flavors: a plain scalar one that works everywhere, an SSE2 one, and an AVX2 one. 
+/// The SIMD flavors handle as many samples as they can in bulk and let the scalar 
+/// flavor take care of the leftovers at the tail. All three produce the exact same 
+/// results, since they clamp and round in the same way.
+///
+/// The `PcmConverter` struct is just a table of function pointers. We pick the best table 
+/// for the current CPU _once_ at startup with `pcm_converter_get`, and then call through it.
+///
+/// The conversions follow the same conventions as dr_wav and dr_mp3:
+///
+///   - `short` covers [-32768, 32767] and maps to [-1.0f, 1.0f) by dividing by 32768.
+///   - `int` covers the full 32-bit range and maps to [-1.0f, 1.0f) by dividing by 2^31. 
+///   - `float` values outside of [-1.0f, 1.0f] are clamped (clipped) before converting back.
+
+struct PcmConverter {
+  const char* name;
+
+  void (*s16_to_f32)(const short* in, float* out, size_t samples_count);
+  void (*f32_to_s16)(const float* in, short* out, size_t samples_count);
+  void (*s32_to_f32)(const int* in, float* out, size_t samples_count);
+  void (*f32_to_s32)(const float* in, int* out, size_t samples_count);
+  void (*s16_to_s32)(const short* in, int* out, size_t samples_count);
+  void (*s32_to_s16)(const int* in, short* out, size_t samples_count);
+
+  /// Stereo is by far the most common layout, so it gets its own fast path. 
+  /// For any other channel count, use `pcm_interleave_f32` and `pcm_deinterleave_f32`.
+
+  void (*interleave_f32_stereo)(const float* left, const float* right, float* out, size_t frames_count);
+  void (*deinterleave_f32_stereo)(const float* in, float* left, float* right, size_t frames_count);
+};
+
+/// The largest `float` below 2^31. Anything at or above 2^31 would overflow an `int`.
+#define PCM_F32_TO_S32_MAX 2147483520.0f
+
+static void pcm_s16_to_f32_scalar(const short* in, float* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = in[i] * (1.0f / 32768.0f);
+  }
+}
+
+static void pcm_f32_to_s16_scalar(const float* in, short* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    float sample = fminf(fmaxf(in[i], -1.0f), 1.0f);
+    long value   = lrintf(sample * 32768.0f);
+
+    out[i] = (short)(value > 32767 ? 32767 : value);
+  }
+}
+
+static void pcm_s32_to_f32_scalar(const int* in, float* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = (float)in[i] * (1.0f / 2147483648.0f);
+  }
+}
+
+static void pcm_f32_to_s32_scalar(const float* in, int* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    float sample = fminf(fmaxf(in[i], -1.0f), 1.0f) * 2147483648.0f;
+    out[i]       = (int)lrintf(fminf(sample, PCM_F32_TO_S32_MAX));
+  }
+}
+
+static void pcm_s16_to_s32_scalar(const short* in, int* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = (int)((unsigned int)(unsigned short)in[i] << 16);
+  }
+}
+
+static void pcm_s32_to_s16_scalar(const int* in, short* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = (short)(in[i] >> 16);
+  }
+}
+
+static void pcm_interleave_f32_stereo_scalar(const float* left, const float* right, float* out, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    out[i * 2 + 0] = left[i];
+    out[i * 2 + 1] = right[i];
+  }
+}
+
+static void pcm_deinterleave_f32_stereo_scalar(const float* in, float* left, float* right, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    left[i]  = in[i * 2 + 0];
+    right[i] = in[i * 2 + 1];
+  }
+}
+
+/// The generic versions for any channel count. `planes` is an array of `channels` pointers, one per channel.
+
+static void pcm_interleave_f32(const float* const* planes, float* out, size_t channels, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    for(size_t ch = 0; ch < channels; ch++) {
+      out[i * channels + ch] = planes[ch][i];
+    }
+  }
+}
+
+static void pcm_deinterleave_f32(const float* in, float* const* planes, size_t channels, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    for(size_t ch = 0; ch < channels; ch++) {
+      planes[ch][i] = in[i * channels + ch];
+    }
+  }
+}
+
+#if defined(PCM_HAS_X86)
+
+/// The SSE2 flavors. Every x86-64 CPU supports SSE2, so these never need a runtime check. 
+/// They process 8 samples (or 4 stereo frames) per iteration.
+
+static void pcm_s16_to_f32_sse2(const short* in, float* out, size_t samples_count) {
+  const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i values = _mm_loadu_si128((const __m128i*)(in + i));
+
+    // Sign-extending the shorts into ints by moving them to the top half and shifting back down.
+    __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+    __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+
+    _mm_storeu_ps(out + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s16_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_f32_to_s16_sse2(const float* in, short* out, size_t samples_count) {
+  const __m128 min   = _mm_set1_ps(-1.0f);
+  const __m128 max   = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128 low  = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 0), min), max), scale);
+    __m128 high = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), min), max), scale);
+
+    // `_mm_packs_epi32` saturates, so a clamped `1.0f` (32768) ends up as 32767.
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+    _mm_storeu_si128((__m128i*)(out + i), packed);
+  }
+
+  pcm_f32_to_s16_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_s32_to_f32_sse2(const int* in, float* out, size_t samples_count) {
+  const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i low  = _mm_loadu_si128((const __m128i*)(in + i + 0));
+    __m128i high = _mm_loadu_si128((const __m128i*)(in + i + 4));
+
+    _mm_storeu_ps(out + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s32_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_f32_to_s32_sse2(const float* in, int* out, size_t samples_count) {
+  const __m128 min        = _mm_set1_ps(-1.0f);
+  const __m128 max        = _mm_set1_ps(1.0f);
+  const __m128 scale      = _mm_set1_ps(2147483648.0f);
+  const __m128 scaled_max = _mm_set1_ps(PCM_F32_TO_S32_MAX);
+  size_t i = 0;
+
+  for(; i + 4 <= samples_count; i += 4) {
+    __m128 sample = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), min), max), scale);
+    _mm_storeu_si128((__m128i*)(out + i), _mm_cvtps_epi32(_mm_min_ps(sample, scaled_max)));
+  }
+
+  pcm_f32_to_s32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_s16_to_s32_sse2(const short* in, int* out, size_t samples_count) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i values = _mm_loadu_si128((const __m128i*)(in + i));
+
+    // Putting zeros in the bottom half is the same as shifting left by 16.
+    _mm_storeu_si128((__m128i*)(out + i + 0), _mm_unpacklo_epi16(zero, values));
+    _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(zero, values));
+  }
+
+  pcm_s16_to_s32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_s32_to_s16_sse2(const int* in, short* out, size_t samples_count) {
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i low  = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(in + i + 0)), 16);
+    __m128i high = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(in + i + 4)), 16);
+
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(low, high));
+  }
+
+  pcm_s32_to_s16_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_interleave_f32_stereo_sse2(const float* left, const float* right, float* out, size_t frames_count) {
+  size_t i = 0;
+
+  for(; i + 4 <= frames_count; i += 4) {
+    __m128 l = _mm_loadu_ps(left + i);
+    __m128 r = _mm_loadu_ps(right + i);
+
+    _mm_storeu_ps(out + i * 2 + 0, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+  }
+
+  pcm_interleave_f32_stereo_scalar(left + i, right + i, out + i * 2, frames_count - i);
+}
+
+static void pcm_deinterleave_f32_stereo_sse2(const float* in, float* left, float* right, size_t frames_count) {
+  size_t i = 0;
+
+  for(; i + 4 <= frames_count; i += 4) {
+    __m128 a = _mm_loadu_ps(in + i * 2 + 0); // L0 R0 L1 R1
+    __m128 b = _mm_loadu_ps(in + i * 2 + 4); // L2 R2 L3 R3
+
+    _mm_storeu_ps(left + i,  _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+
+  pcm_deinterleave_f32_stereo_scalar(in + i * 2, left + i, right + i, frames_count - i);
+}
+
+/// The AVX2 flavors. These process 16 samples per iteration. Only the conversions that 
+/// actually benefit from the wider registers get an AVX2 flavor, the rest reuse the SSE2 ones.
+
+PCM_TARGET_AVX2 static void pcm_s16_to_f32_avx2(const short* in, float* out, size_t samples_count) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+  size_t i = 0;
+
+  for(; i + 16 <= samples_count; i += 16) {
+    __m256i low  = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 0)));
+    __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 8)));
+
+    _mm256_storeu_ps(out + i + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+    _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s16_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+PCM_TARGET_AVX2 static void pcm_f32_to_s16_avx2(const float* in, short* out, size_t samples_count) {
+  const __m256 min   = _mm256_set1_ps(-1.0f);
+  const __m256 max   = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(32768.0f);
+  size_t i = 0;
+
+  for(; i + 16 <= samples_count; i += 16) {
+    __m256 low  = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 0), min), max), scale);
+    __m256 high = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 8), min), max), scale);
+
+    // The AVX2 pack works on each 128-bit half separately, so we have to put the halves back in order.
+    __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(low), _mm256_cvtps_epi32(high));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+
+  pcm_f32_to_s16_scalar(in + i, out + i, samples_count - i);
+}
+
+PCM_TARGET_AVX2 static void pcm_s32_to_f32_avx2(const int* in, float* out, size_t samples_count) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+  size_t i = 0;
+
+  for(; i + 16 <= samples_count; i += 16) {
+    __m256i low  = _mm256_loadu_si256((const __m256i*)(in + i + 0));
+    __m256i high = _mm256_loadu_si256((const __m256i*)(in + i + 8));
+
+    _mm256_storeu_ps(out + i + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+    _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s32_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+PCM_TARGET_AVX2 static void pcm_f32_to_s32_avx2(const float* in, int* out, size_t samples_count) {
+  const __m256 min        = _mm256_set1_ps(-1.0f);
+  const __m256 max        = _mm256_set1_ps(1.0f);
+  const __m256 scale      = _mm256_set1_ps(2147483648.0f);
+  const __m256 scaled_max = _mm256_set1_ps(PCM_F32_TO_S32_MAX);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m256 sample = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), min), max), scale);
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_cvtps_epi32(_mm256_min_ps(sample, scaled_max)));
+  }
+
+  pcm_f32_to_s32_scalar(in + i, out + i, samples_count - i);
+}
+
+/// Checking whether the CPU _and_ the OS support AVX2. The OS part matters, since the OS 
+/// has to save the wider registers when switching threads.
+
+static bool pcm_cpu_has_avx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+
+  bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+  if(!has_avx || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // PCM_HAS_X86
+
+static const PcmConverter PCM_CONVERTER_SCALAR = {
+  "scalar",
+  pcm_s16_to_f32_scalar, pcm_f32_to_s16_scalar, 
+  pcm_s32_to_f32_scalar, pcm_f32_to_s32_scalar, 
+  pcm_s16_to_s32_scalar, pcm_s32_to_s16_scalar,
+  pcm_interleave_f32_stereo_scalar, pcm_deinterleave_f32_stereo_scalar,
+};
+
+#if defined(PCM_HAS_X86)
+
+static const PcmConverter PCM_CONVERTER_SSE2 = {
+  "sse2",
+  pcm_s16_to_f32_sse2, pcm_f32_to_s16_sse2, 
+  pcm_s32_to_f32_sse2, pcm_f32_to_s32_sse2, 
+  pcm_s16_to_s32_sse2, pcm_s32_to_s16_sse2,
+  pcm_interleave_f32_stereo_sse2, pcm_deinterleave_f32_stereo_sse2,
+};
+
+static const PcmConverter PCM_CONVERTER_AVX2 = {
+  "avx2",
+  pcm_s16_to_f32_avx2, pcm_f32_to_s16_avx2, 
+  pcm_s32_to_f32_avx2, pcm_f32_to_s32_avx2, 
+  pcm_s16_to_s32_sse2, pcm_s32_to_s16_sse2,
+  pcm_interleave_f32_stereo_sse2, pcm_deinterleave_f32_stereo_sse2,
+};
+
+#endif // PCM_HAS_X86
+
+/// Returns the best converter table for the CPU we're running on.
+
+static const PcmConverter* pcm_converter_get() {
+#if defined(PCM_HAS_X86)
+  return pcm_cpu_has_avx2() ? &PCM_CONVERTER_AVX2 : &PCM_CONVERTER_SSE2;
+#else
+  return &PCM_CONVERTER_SCALAR;
+#endif
+}
+
+/// The loads at the top of `main` pass `nullptr` for the allocation callbacks, which means every 
+/// load goes through the global heap. That's fine for a couple of files. But, when a level 
+/// loads thousands of small sound effects, all of those tiny allocations and frees will 
+/// fragment the heap over time. 
+///
+/// Instead, we can give dr_mp3 our own allocator through the `drmp3_allocation_callbacks` struct. 
+/// The allocator below is a simple "arena" (or "bump") allocator. It grabs one big block of 
+/// memory up front and hands out pieces of it by just bumping an offset. Freeing does nothing 
+/// (unless it's the very last allocation), and once a load is done, we "reset" the arena 
+/// by setting the offset back to zero. 
+///
+/// Each thread gets its own arena (see `audio_arena_get_thread`), so threads that load 
+/// sounds at the same time never have to share or lock anything. 
+///
+/// If an allocation doesn't fit in the arena, we fall back to the heap instead of failing, 
+/// and count it in `fallbacks_count` so you know the arena should be bigger.
+///
+/// The arena also keeps a few counters around. `bytes_allocated` and `allocations_count` 
+/// are per-load and get cleared on every reset. `high_water_mark` is the most memory a single 
+/// load has ever used, which is a good value to size the arena with.
+
+#define AUDIO_ARENA_CAPACITY  (4 * 1024 * 1024)
+#define AUDIO_ARENA_ALIGNMENT 16
+
+struct AudioArena {
+  unsigned char* memory; 
+  size_t capacity;
+  size_t offset; 
+  size_t last_offset; // Where the most recent allocation started
+
+  size_t bytes_allocated;
+  size_t allocations_count;
+  size_t fallbacks_count;
+  size_t high_water_mark;
+};
+
+/// Every allocation is preceded by a small header that stores its size, so that `realloc` 
+/// knows how much to copy. The header is as big as the alignment to keep the memory aligned.
+
+struct AudioArenaHeader {
+  size_t size;
+  unsigned char padding[AUDIO_ARENA_ALIGNMENT - sizeof(size_t)];
+};
+
+static bool audio_arena_owns(AudioArena* arena, void* ptr) {
+  return (unsigned char*)ptr >= arena->memory && (unsigned char*)ptr < arena->memory + arena->capacity;
+}
+
+static void* audio_arena_malloc(size_t size, void* user_data) {
+  AudioArena* arena = (AudioArena*)user_data;
+
+  size_t aligned_size = (size + (AUDIO_ARENA_ALIGNMENT - 1)) & ~(size_t)(AUDIO_ARENA_ALIGNMENT - 1);
+  size_t total_size   = sizeof(AudioArenaHeader) + aligned_size;
+
+  arena->allocations_count++;
+  arena->bytes_allocated += size;
+
+  // Not enough space left. Go to the heap instead.
+  if(arena->offset + total_size > arena->capacity) {
+    arena->fallbacks_count++;
+    return malloc(size);
+  }
+
+  AudioArenaHeader* header = (AudioArenaHeader*)(arena->memory + arena->offset);
+  header->size             = size;
+
+  arena->last_offset = arena->offset;
+  arena->offset     += total_size;
+
+  arena->high_water_mark = arena->offset > arena->high_water_mark ? arena->offset : arena->high_water_mark;
+  return header + 1;
+}
+
+static void audio_arena_free(void* ptr, void* user_data) {
+  AudioArena* arena = (AudioArena*)user_data;
+
+  if(!ptr) {
+    return;
+  }
+
+  if(!audio_arena_owns(arena, ptr)) {
+    free(ptr);
+    return;
+  }
+
+  // Only the most recent allocation can actually be given back. Everything else waits for the reset.
+  AudioArenaHeader* header = (AudioArenaHeader*)ptr - 1;
+  if((unsigned char*)header == arena->memory + arena->last_offset) {
+    arena->offset = arena->last_offset;
+  }
+}
+
+static void* audio_arena_realloc(void* ptr, size_t new_size, void* user_data) {
+  AudioArena* arena = (AudioArena*)user_data;
+
+  if(!ptr) {
+    return audio_arena_malloc(new_size, user_data);
+  }
+
+  if(!audio_arena_owns(arena, ptr)) {
+    return realloc(ptr, new_size);
+  }
+
+  AudioArenaHeader* header = (AudioArenaHeader*)ptr - 1;
+  size_t old_size          = header->size;
+
+  // If it's the most recent allocation and there's room, we can just grow it in place.
+  if((unsigned char*)header == arena->memory + arena->last_offset) {
+    size_t aligned_size = (new_size + (AUDIO_ARENA_ALIGNMENT - 1)) & ~(size_t)(AUDIO_ARENA_ALIGNMENT - 1);
+    size_t new_offset   = arena->last_offset + sizeof(AudioArenaHeader) + aligned_size;
+
+    if(new_offset <= arena->capacity) {
+      arena->bytes_allocated += new_size > old_size ? new_size - old_size : 0;
+      arena->offset           = new_offset;
+      arena->high_water_mark  = new_offset > arena->high_water_mark ? new_offset : arena->high_water_mark;
+
+      header->size = new_size;
+      return ptr;
+    }
+  }
+
+  void* new_ptr = audio_arena_malloc(new_size, user_data);
+  if(new_ptr) {
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  }
+
+  return new_ptr;
+}
+
+/// Call this once a load is done _and_ you've finished with every pointer dr_mp3 gave you 
+/// during that load (including the samples buffer returned by the `_open_file_and_read_pcm_frames_*` 
+/// functions). Make sure to copy out anything you want to keep before resetting.
+
+static void audio_arena_reset(AudioArena* arena) {
+  arena->offset            = 0;
+  arena->last_offset       = 0;
+  arena->bytes_allocated   = 0;
+  arena->allocations_count = 0;
+  arena->fallbacks_count   = 0;
+}
+
+/// Returns the arena of the calling thread, creating it the first time it's used on that thread. 
+/// The memory of the arena is given back when the thread exits.
+
+struct AudioArenaOwner {
+  AudioArena arena = {};
+
+  ~AudioArenaOwner() {
+    free(arena.memory);
+  }
+};
+
+static AudioArena* audio_arena_get_thread() {
+  static thread_local AudioArenaOwner owner;
+
+  if(!owner.arena.memory) {
+    owner.arena.memory   = (unsigned char*)malloc(AUDIO_ARENA_CAPACITY);
+    owner.arena.capacity = AUDIO_ARENA_CAPACITY;
+  }
+
+  return &owner.arena;
+}
+
+/// Finally, the callbacks we actually hand over to dr_mp3. The `pUserData` is the arena itself.
+
+static drmp3_allocation_callbacks audio_arena_callbacks(AudioArena* arena) {
+  drmp3_allocation_callbacks callbacks;
+  callbacks.pUserData = arena;
+  callbacks.onMalloc  = audio_arena_malloc;
+  callbacks.onRealloc = audio_arena_realloc;
+  callbacks.onFree    = audio_arena_free;
+
+  return callbacks;
+}
+
+/// In order to know the total amount of PCM frames in an MP3 file, or to seek accurately, 
+/// dr_mp3 has to scan through the whole file. Doing that on every launch for every music 
+/// track adds up. But the result never changes as long as the file doesn't. 
+///
+/// So, we can compute the seek points (and the total frame count) once, and save them to a small 
+/// "sidecar" file right next to the MP3 file (`audio.mp3` -> `audio.mp3.seek`). The next time we 
+/// open the file, we just read the sidecar back and give the seek points to dr_mp3 using 
+/// `drmp3_bind_seek_table`. From then on, seeking jumps straight to the nearest seek point.
+///
+/// To know whether the sidecar is still valid, it stores the size and the modification time 
+/// of the MP3 file, along with a hash of its first and last 64KB. Hashing the whole file would 
+/// defeat the whole point, since it would read the entire file again. If anything doesn't match, 
+/// we just rebuild the sidecar.
+///
+/// The sidecar is written in the native byte order. If you share caches between machines with 
+/// different endianness, bump the version or convert the values when reading/writing.
+
+#define MP3_MAX_SEEK_POINTS      1024
+#define MP3_SEEK_CACHE_VERSION   1
+#define MP3_SEEK_CACHE_HASH_SIZE (64 * 1024)
+
+struct Mp3SeekCacheHeader {
+  char magic[4]; // Always "MP3S"
+  drmp3_uint32 version;
+
+  drmp3_uint64 file_size; 
+  drmp3_uint64 file_mtime; 
+  drmp3_uint64 file_hash;
+
+  drmp3_uint64 total_frames_count;
+  drmp3_uint32 seek_points_count;
+  drmp3_uint32 padding;
+};
+
+/// The seek table we keep around for an open MP3 file. Keep in mind that dr_mp3 does _not_ 
+/// copy the seek points when binding them, so this must outlive the `drmp3` struct.
+
+struct Mp3SeekTable {
+  drmp3_seek_point* seek_points; 
+  drmp3_uint32 seek_points_count;
+  drmp3_uint64 total_frames_count;
+};
+
+/// A simple FNV-1a hash. It's not cryptographic in any way, but it's more than enough to notice a changed file.
+
+static drmp3_uint64 mp3_hash_bytes(drmp3_uint64 hash, const unsigned char* bytes, size_t size) {
+  for(size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static bool mp3_get_file_key(const char* path, Mp3SeekCacheHeader* header) {
+  struct stat file_stat; 
+  if(stat(path, &file_stat) != 0) {
+    return false;
+  }
+
+  FILE* file = fopen(path, "rb");
+  if(!file) {
+    return false;
+  }
+
+  header->file_size  = (drmp3_uint64)file_stat.st_size;
+  header->file_mtime = (drmp3_uint64)file_stat.st_mtime;
+  header->file_hash  = 14695981039346656037ull;
+
+  // On the heap, since several threads may be hashing files at the same time.
+  std::vector<unsigned char> chunk(MP3_SEEK_CACHE_HASH_SIZE);
+
+  size_t bytes_read = fread(chunk.data(), 1, MP3_SEEK_CACHE_HASH_SIZE, file);
+  header->file_hash = mp3_hash_bytes(header->file_hash, chunk.data(), bytes_read);
+
+  if(header->file_size > MP3_SEEK_CACHE_HASH_SIZE * 2) {
+    fseek(file, -MP3_SEEK_CACHE_HASH_SIZE, SEEK_END);
+
+    bytes_read        = fread(chunk.data(), 1, MP3_SEEK_CACHE_HASH_SIZE, file);
+    header->file_hash = mp3_hash_bytes(header->file_hash, chunk.data(), bytes_read);
+  }
+
+  fclose(file);
+  return true;
+}
+
+static bool mp3_seek_cache_read(const char* cache_path, const Mp3SeekCacheHeader* expected, Mp3SeekTable* table) {
+  FILE* file = fopen(cache_path, "rb");
+  if(!file) {
+    return false;
+  }
+
+  Mp3SeekCacheHeader header;
+  bool is_valid = fread(&header, sizeof(header), 1, file) == 1 && 
+                  memcmp(header.magic, "MP3S", 4) == 0 && 
+                  header.version == MP3_SEEK_CACHE_VERSION && 
+                  header.file_size == expected->file_size && 
+                  header.file_mtime == expected->file_mtime && 
+                  header.file_hash == expected->file_hash && 
+                  header.seek_points_count <= MP3_MAX_SEEK_POINTS;
+
+  if(is_valid) {
+    table->seek_points_count  = header.seek_points_count;
+    table->total_frames_count = header.total_frames_count;
+
+    is_valid = fread(table->seek_points, sizeof(drmp3_seek_point), header.seek_points_count, file) == header.seek_points_count;
+  }
+
+  fclose(file);
+  return is_valid;
+}
+
+/// We write to a temporary file first and then rename it, so that a crash never leaves a torn 
+/// sidecar behind. The temporary name is unique per process and per write, since several threads 
+/// (or processes) may be building the sidecar of the same file at the same time.
+
+static void mp3_seek_cache_write(const char* cache_path, Mp3SeekCacheHeader* header, const Mp3SeekTable* table) {
+  static std::atomic<unsigned int> temp_counter(0);
+
+  char temp_path[1100];
+  snprintf(temp_path, sizeof(temp_path), "%s.%d.%u.tmp", cache_path, (int)getpid(), temp_counter.fetch_add(1));
+
+  FILE* file = fopen(temp_path, "wb");
+  if(!file) {
+    return; // Not being able to write the cache is not an error. We'll just rebuild it next time.
+  }
+
+  memcpy(header->magic, "MP3S", 4);
+  header->version            = MP3_SEEK_CACHE_VERSION;
+  header->total_frames_count = table->total_frames_count;
+  header->seek_points_count  = table->seek_points_count;
+  header->padding            = 0;
+
+  bool is_written = fwrite(header, sizeof(Mp3SeekCacheHeader), 1, file) == 1 && 
+                    fwrite(table->seek_points, sizeof(drmp3_seek_point), table->seek_points_count, file) == table->seek_points_count;
+  is_written      = fclose(file) == 0 && is_written;
+
+  if(is_written) {
+    rename(temp_path, cache_path);
+  }
+  else {
+    remove(temp_path);
+  }
+}
+
+/// Fills `table` for the MP3 file at `path`, using `mp3` (which must already be initialized with 
+/// that same file) to build the table when the sidecar is missing or out of date. The function 
+/// returns `true` if the sidecar was used. Free `table->seek_points` with `free` when done.
+
+static bool mp3_seek_table_load(drmp3* mp3, const char* path, Mp3SeekTable* table) {
+  table->seek_points        = (drmp3_seek_point*)malloc(sizeof(drmp3_seek_point) * MP3_MAX_SEEK_POINTS);
+  table->seek_points_count  = 0;
+  table->total_frames_count = 0;
+
+  if(!table->seek_points) {
+    table->total_frames_count = drmp3_get_pcm_frame_count(mp3);
+    return false;
+  }
+
+  char cache_path[1024];
+  snprintf(cache_path, sizeof(cache_path), "%s.seek", path);
+
+  Mp3SeekCacheHeader header;
+  bool has_key = mp3_get_file_key(path, &header);
+
+  if(has_key && mp3_seek_cache_read(cache_path, &header, table)) {
+    return true;
+  }
+
+  /// The slow path. `drmp3_calculate_seek_points` takes the capacity of the array in `seek_points_count` 
+  /// and writes back how many seek points it actually filled. Both this and `drmp3_get_pcm_frame_count` 
+  /// scan through the whole file, but only the MP3 frame headers, without decoding anything.
+
+  table->seek_points_count  = MP3_MAX_SEEK_POINTS;
+  table->total_frames_count = drmp3_get_pcm_frame_count(mp3);
+
+  if(!drmp3_calculate_seek_points(mp3, &table->seek_points_count, table->seek_points)) {
+    table->seek_points_count = 0;
+  }
+
+  if(has_key) {
+    mp3_seek_cache_write(cache_path, &header, table);
+  }
+
+  return false;
+}
+
+/// MP3 decoding is inherently serial. Each MP3 frame depends on the frames before it (the 
+/// "bit reservoir" and the overlap of the filter banks). That means a single `drmp3` 
+/// instance can only ever use one core, which is slow for long music files. 
+///
+/// However, dr_mp3 can compute "seek points" for us with `drmp3_calculate_seek_points`. 
+/// Each seek point records a byte position in the file, the PCM frame it corresponds to, and 
+/// how many MP3 frames need to be decoded (and thrown away) beforehand to get the decoder into 
+/// the right state. With those, we can split the file into ranges, give each range its own 
+/// `drmp3` instance on its own thread, and have each one decode straight into its own slice 
+/// of the output buffer. 
+///
+/// At the start of each range, the decoder is "cold", though. To make sure the output is exactly 
+/// the same as decoding the file serially, each worker starts decoding `MP3_RANGE_OVERLAP_FRAMES` 
+/// frames _before_ its range and throws those away. That warms up both the bit reservoir and the 
+/// filter banks. Two MP3 frames' worth (1152 PCM frames each) is plenty.
+
+#define MP3_RANGE_OVERLAP_FRAMES (1152 * 2)
+
+struct Mp3DecodeRange {
+  drmp3_uint64 first_frame; 
+  drmp3_uint64 frames_count;
+
+  drmp3_uint64 frames_read; // Written by the worker. Anything less than `frames_count` means the range failed.
+};
+
+static void mp3_decode_range(const char* path, drmp3_seek_point* seek_points, drmp3_uint32 seek_points_count, Mp3DecodeRange* range, float* out_samples) {
+  range->frames_read = 0;
+
+  drmp3 mp3; 
+  if(!drmp3_init_file(&mp3, path, nullptr)) {
+    return;
+  }
+
+  // With the seek table bound, seeking jumps straight to the closest seek point instead of decoding from the start.
+  drmp3_bind_seek_table(&mp3, seek_points_count, seek_points);
+
+  drmp3_uint64 warmup_start = range->first_frame > MP3_RANGE_OVERLAP_FRAMES ? range->first_frame - MP3_RANGE_OVERLAP_FRAMES : 0;
+  drmp3_seek_to_pcm_frame(&mp3, warmup_start);
+
+  // Decoding the overlap and throwing it away.
+  float discard_buffer[1152 * 2];
+  drmp3_uint64 frames_to_discard = range->first_frame - warmup_start;
+
+  while(frames_to_discard > 0) {
+    drmp3_uint64 frames_to_read = frames_to_discard < 1152 ? frames_to_discard : 1152;
+    drmp3_uint64 frames_read    = drmp3_read_pcm_frames_f32(&mp3, frames_to_read, discard_buffer);
+
+    if(frames_read == 0) {
+      break;
+    }
+
+    frames_to_discard -= frames_read;
+  }
+
+  range->frames_read = drmp3_read_pcm_frames_f32(&mp3, range->frames_count, out_samples + range->first_frame * mp3.channels);
+  drmp3_uninit(&mp3);
+}
+
+/// Decodes the whole MP3 file at `path` using `threads_count` threads. It returns a buffer 
+/// allocated with `malloc` (so free it with `free`), or `nullptr` if the file could not be opened. 
+/// If _any_ range comes up short, the whole decode fails, since part of the buffer would be garbage.
+
+static float* mp3_decode_parallel(const char* path, unsigned int threads_count, drmp3_config* out_config, drmp3_uint64* out_frames_count) {
+  drmp3 mp3; 
+  if(!drmp3_init_file(&mp3, path, nullptr)) {
+    return nullptr;
+  }
+
+  /// The seek points come from the sidecar cache when there is one. Otherwise, they are 
+  /// computed (and cached) here.
+
+  Mp3SeekTable table;
+  mp3_seek_table_load(&mp3, path, &table);
+
+  drmp3_uint32 seek_points_count  = table.seek_points_count;
+  drmp3_seek_point* seek_points   = table.seek_points;
+  drmp3_uint64 total_frames_count = table.total_frames_count;
+
+  if(seek_points_count == 0) {
+    threads_count = 1; // Without seek points, there is nothing to split on
+  }
+
+  out_config->channels   = mp3.channels;
+  out_config->sampleRate = mp3.sampleRate;
+  *out_frames_count      = total_frames_count;
+
+  drmp3_uninit(&mp3);
+
+  float* samples = (float*)malloc(total_frames_count * out_config->channels * sizeof(float));
+  if(!samples) {
+    free(seek_points);
+    return nullptr;
+  }
+
+  /// Splitting the file into ranges. Every range starts right at a seek point, so each 
+  /// worker's seek is as cheap as it can be.
+
+  if(threads_count > seek_points_count && seek_points_count > 0) {
+    threads_count = seek_points_count;
+  }
+
+  std::vector<Mp3DecodeRange> ranges(threads_count);
+
+  for(unsigned int i = 0; i < threads_count; i++) {
+    ranges[i].first_frame = i == 0 ? 0 : seek_points[(size_t)i * seek_points_count / threads_count].pcmFrameIndex;
+  }
+
+  for(unsigned int i = 0; i < threads_count; i++) {
+    drmp3_uint64 next_first_frame = (i + 1 < threads_count) ? ranges[i + 1].first_frame : total_frames_count;
+    ranges[i].frames_count        = next_first_frame - ranges[i].first_frame;
+  }
+
+  std::vector<std::thread> workers;
+  for(unsigned int i = 0; i < threads_count; i++) {
+    workers.emplace_back(mp3_decode_range, path, seek_points, seek_points_count, &ranges[i], samples);
+  }
+
+  for(std::thread& worker : workers) {
+    worker.join();
+  }
+
+  free(seek_points);
+
+  for(const Mp3DecodeRange& range : ranges) {
+    if(range.frames_read < range.frames_count) {
+      free(samples);
+      return nullptr;
+    }
+  }
+
+  return samples;
+}
+
 int main() {
   /// In order to load a MP3 file using dr_mp3, you can call the function 
   /// below with the specific path to the MP3 file. The function will 
@@ -101,8 +981,177 @@ int main() {
     return -1;
   }
 
+  /// If your mixer wants a different format than the one you read, convert the whole buffer at 
+  /// once with the `PcmConverter` from above, instead of sample by sample on the audio thread. 
+  /// Here, we convert the decoded `float`s to `short`s (and back) with every flavor, and print the 
+  /// samples per second of each one.
+
+  const PcmConverter* converter = pcm_converter_get();
+  printf("PCM CONVERTER: using '%s'\n", converter->name);
+
+  const PcmConverter* converters[] = {
+    &PCM_CONVERTER_SCALAR,
+#if defined(PCM_HAS_X86)
+    &PCM_CONVERTER_SSE2,
+    converter == &PCM_CONVERTER_AVX2 ? &PCM_CONVERTER_AVX2 : nullptr,
+#endif
+  };
+
+  size_t samples_count = (size_t)total_frames * mp3_config.channels;
+  short* s16_samples   = (short*)malloc(samples_count * sizeof(short));
+  float* f32_samples   = (float*)malloc(samples_count * sizeof(float));
+
+  for(const PcmConverter* conv : converters) {
+    if(!conv || !s16_samples || !f32_samples) {
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    conv->f32_to_s16(samples, s16_samples, samples_count);
+    double to_s16_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    conv->s16_to_f32(s16_samples, f32_samples, samples_count);
+    double to_f32_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("  [%-6s] f32 -> s16 %8.1f Msamples/sec, s16 -> f32 %8.1f Msamples/sec\n", 
+           conv->name, samples_count / to_s16_seconds / 1e6, samples_count / to_f32_seconds / 1e6);
+  }
+
+  free(s16_samples);
+  free(f32_samples);
+
   /// Since the `samples` buffer is allocated by dr_mp3, we need to call 
   /// this function below to deallocate the samples buffer.
 
   drmp3_free(samples);
+
+  /// Here is the arena allocator from above in action. We load a list of MP3 files, 
+  /// one after the other, all on the same thread. Each load allocates from the thread's 
+  /// arena and, once we're done with the samples, we reset the arena for the next load. 
+  /// No matter how many files we load, the heap is never touched (unless the arena overflows).
+
+  const char* sfx_paths[] = {
+    "path/to/footstep.mp3",
+    "path/to/gunshot.mp3",
+    "path/to/explosion.mp3",
+  };
+
+  AudioArena* arena                       = audio_arena_get_thread();
+  drmp3_allocation_callbacks arena_allocs = audio_arena_callbacks(arena);
+
+  for(const char* sfx_path : sfx_paths) {
+    drmp3_config sfx_config;
+    drmp3_uint64 sfx_frames;
+
+    float* sfx_samples = drmp3_open_file_and_read_pcm_frames_f32(sfx_path, &sfx_config, &sfx_frames, &arena_allocs);
+    if(!sfx_samples) {
+      printf("ERROR: Could not load '%s'!\n", sfx_path);
+      audio_arena_reset(arena);
+      continue;
+    }
+
+    // ... Copy `sfx_samples` into your sound bank or hand them to the mixer here ...
+
+    printf("ARENA: '%s' -> %zu bytes in %zu allocations (%zu fallbacks)\n", 
+           sfx_path, arena->bytes_allocated, arena->allocations_count, arena->fallbacks_count);
+
+    drmp3_free(sfx_samples, &arena_allocs);
+    audio_arena_reset(arena);
+  }
+
+  printf("ARENA: high-water mark = %zu bytes\n", arena->high_water_mark);
+
+  /// Now let's decode the same file with the parallel decoder from above, using 1 thread up to 
+  /// as many threads as the machine has. For each thread count, we print the decode time, the 
+  /// speedup compared to the plain serial path, and whether the output is identical to it.
+
+  drmp3_config serial_config;
+  drmp3_uint64 serial_frames;
+
+  auto serial_start     = std::chrono::steady_clock::now();
+  float* serial_samples = drmp3_open_file_and_read_pcm_frames_f32("path/to/audio.mp3", &serial_config, &serial_frames, nullptr);
+  double serial_ms      = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - serial_start).count();
+
+  if(!serial_samples) {
+    printf("ERROR: Could not load MP3 file!\n");
+    return -1;
+  }
+
+  printf("SERIAL: %.2f ms\n", serial_ms);
+
+  unsigned int max_threads = std::thread::hardware_concurrency();
+  max_threads              = max_threads == 0 ? 1 : max_threads;
+
+  for(unsigned int threads_count = 1; threads_count <= max_threads; threads_count++) {
+    drmp3_config parallel_config;
+    drmp3_uint64 parallel_frames;
+
+    auto start              = std::chrono::steady_clock::now();
+    float* parallel_samples = mp3_decode_parallel("path/to/audio.mp3", threads_count, &parallel_config, &parallel_frames);
+    double elapsed_ms       = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if(!parallel_samples) {
+      printf("ERROR: Could not load MP3 file!\n");
+      return -1;
+    }
+
+    bool is_identical = parallel_frames == serial_frames && 
+                        memcmp(parallel_samples, serial_samples, serial_frames * serial_config.channels * sizeof(float)) == 0;
+
+    printf("PARALLEL (%2u threads): %.2f ms, %.2fx speedup, %s\n", 
+           threads_count, elapsed_ms, serial_ms / elapsed_ms, is_identical ? "identical" : "MISMATCH");
+
+    free(parallel_samples);
+  }
+
+  drmp3_free(serial_samples, nullptr);
+
+  /// Finally, let's compare opening and seeking with and without the seek table cache from above. 
+  ///
+  /// Without the cache, getting the total frame count means scanning the whole file, and every 
+  /// seek has to decode its way from the start of the file. With the cache, opening is a small 
+  /// read of the sidecar, and seeking jumps to the nearest seek point. 
+  ///
+  /// The first run will build the sidecar, so run the sample twice to see the cached numbers.
+
+  const int seeks_count = 100;
+
+  for(int use_cache = 0; use_cache < 2; use_cache++) {
+    auto open_start = std::chrono::steady_clock::now();
+
+    drmp3 seek_mp3; 
+    if(!drmp3_init_file(&seek_mp3, "path/to/audio.mp3", nullptr)) {
+      printf("ERROR: Could not load MP3 file!\n");
+      return -1;
+    }
+
+    Mp3SeekTable table = {};
+    bool is_cached     = false;
+
+    if(use_cache) {
+      is_cached = mp3_seek_table_load(&seek_mp3, "path/to/audio.mp3", &table);
+      drmp3_bind_seek_table(&seek_mp3, table.seek_points_count, table.seek_points);
+    }
+    else {
+      table.total_frames_count = drmp3_get_pcm_frame_count(&seek_mp3);
+    }
+
+    double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - open_start).count();
+
+    // Seeking to spread-out positions, in a scrambled order.
+    auto seek_start = std::chrono::steady_clock::now();
+    for(int i = 0; i < seeks_count; i++) {
+      drmp3_uint64 target = table.total_frames_count * ((i * 37) % seeks_count) / seeks_count;
+      drmp3_seek_to_pcm_frame(&seek_mp3, target);
+    }
+    double seek_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seek_start).count();
+
+    printf("%s: open = %.3f ms, seek avg = %.3f ms\n", 
+           use_cache ? (is_cached ? "SEEK TABLE (cached)" : "SEEK TABLE (built)") : "NO SEEK TABLE", 
+           open_ms, seek_ms / seeks_count);
+
+    drmp3_uninit(&seek_mp3);
+    free(table.seek_points);
+  }
 }
@@ -4,12 +4,888 @@
 #include <cstdio>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PCM_HAS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PCM_TARGET_AVX2
+#else
+#define PCM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 /// You can find the dr_wav library at the link below: 
 ///
 /// https://github.com/mackron/dr_libs
 
+/// Decoding the whole WAV file up front is fine for short sound effects. However, for 
+/// long tracks (think hour-long ambience loops), it means hundreds of megabytes per voice. 
+/// Instead, we can _stream_ the file: a background thread decodes small, fixed-size blocks 
+/// with `drwav_read_pcm_frames_f32` into a ring buffer, and the audio callback pulls frames 
+/// out of that ring buffer. 
+///
+/// The ring buffer below is a single-producer/single-consumer (SPSC) queue. Only the decode 
+/// thread writes into it and only the audio callback reads from it. Because of that, we 
+/// can get away with two atomic counters and no locks at all. The audio callback will 
+/// _never_ wait on the decode thread. 
+///
+/// Both sizes are in samples (not frames) and the ring size _must_ be a power of two, 
+/// since we use a mask to wrap the indices around. With the values below, the whole 
+/// stream costs around 20KB no matter how long the WAV file is. A block has to hold at least 
+/// a few whole frames, so files with more than 8 channels are rejected.
+
+#define WAV_STREAM_BLOCK_SAMPLES 1024
+#define WAV_STREAM_RING_SAMPLES  4096
+#define WAV_STREAM_MAX_CHANNELS  8
+
+struct WavStream {
+  drwav wav;
+  bool is_looping;
+
+  float ring[WAV_STREAM_RING_SAMPLES];
+  float block[WAV_STREAM_BLOCK_SAMPLES];
+
+  /// These are total counts of samples written/read since the stream started. 
+  /// They only ever go up, and the difference between them is the amount of 
+  /// samples currently in the ring buffer.
+  std::atomic<size_t> write_pos; 
+  std::atomic<size_t> read_pos;
+
+  std::atomic<bool> is_running;
+  std::atomic<bool> reached_end;
+  std::atomic<size_t> underruns;
+
+  std::thread decode_thread;
+};
+
+/// This is the background decode thread. It keeps the ring buffer topped up one block at a time. 
+/// We always decode whole frames, so the block size is rounded down to a multiple of the channels.
+
+static void wav_stream_decode_loop(WavStream* stream) {
+  size_t block_frames  = WAV_STREAM_BLOCK_SAMPLES / stream->wav.channels;
+  size_t block_samples = block_frames * stream->wav.channels;
+
+  while(stream->is_running.load(std::memory_order_relaxed)) {
+    size_t write_pos  = stream->write_pos.load(std::memory_order_relaxed);
+    size_t free_space = WAV_STREAM_RING_SAMPLES - (write_pos - stream->read_pos.load(std::memory_order_acquire));
+
+    // Not enough space for a full block. Let the audio callback catch up.
+    if(free_space < block_samples || stream->reached_end.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    size_t frames_read = drwav_read_pcm_frames_f32(&stream->wav, block_frames, stream->block);
+    bool is_end        = false;
+
+    // We reached the end of the file. Either start over or stop decoding.
+    if(frames_read < block_frames) {
+      if(stream->is_looping) {
+        drwav_seek_to_pcm_frame(&stream->wav, 0);
+      }
+      else {
+        is_end = true;
+      }
+    }
+
+    // Copying the block into the ring buffer, taking care of the wrap around.
+    size_t samples_read = frames_read * stream->wav.channels;
+    size_t start        = write_pos & (WAV_STREAM_RING_SAMPLES - 1);
+    size_t first_part   = samples_read < (WAV_STREAM_RING_SAMPLES - start) ? samples_read : (WAV_STREAM_RING_SAMPLES - start);
+
+    memcpy(stream->ring + start, stream->block, first_part * sizeof(float));
+    memcpy(stream->ring, stream->block + first_part, (samples_read - first_part) * sizeof(float));
+
+    // The `release` here makes sure the samples above are visible before the new write position is.
+    stream->write_pos.store(write_pos + samples_read, std::memory_order_release);
+
+    // Only _after_ the last block is published. Otherwise, the audio callback could see the end 
+    // of the stream with the old write position, and drop the last block.
+    if(is_end) {
+      stream->reached_end.store(true, std::memory_order_release);
+    }
+  }
+}
+
+static bool wav_stream_open(WavStream* stream, const char* path, bool is_looping) {
+  if(!drwav_init_file(&stream->wav, path, nullptr)) {
+    return false;
+  }
+
+  if(stream->wav.channels == 0 || stream->wav.channels > WAV_STREAM_MAX_CHANNELS) {
+    drwav_uninit(&stream->wav);
+    return false;
+  }
+
+  stream->is_looping = is_looping;
+  stream->write_pos.store(0);
+  stream->read_pos.store(0);
+  stream->underruns.store(0);
+  stream->reached_end.store(false);
+  stream->is_running.store(true);
+
+  stream->decode_thread = std::thread(wav_stream_decode_loop, stream);
+  return true;
+}
+
+/// This is what you would call from inside the audio callback. It copies up to `frames_count` 
+/// frames into `out_samples` and fills whatever is missing with silence. It never locks 
+/// and never waits on the decode thread. If the decode thread couldn't keep up, we count 
+/// it as an "underrun" so you know you need a bigger ring buffer.
+///
+/// The function returns the number of frames that were actually read from the stream.
+
+static size_t wav_stream_read(WavStream* stream, float* out_samples, size_t frames_count) {
+  size_t channels  = stream->wav.channels;
+  size_t read_pos  = stream->read_pos.load(std::memory_order_relaxed);
+  size_t available = (stream->write_pos.load(std::memory_order_acquire) - read_pos) / channels;
+
+  size_t frames_read  = frames_count < available ? frames_count : available;
+  size_t samples_read = frames_read * channels;
+  size_t start        = read_pos & (WAV_STREAM_RING_SAMPLES - 1);
+  size_t first_part   = samples_read < (WAV_STREAM_RING_SAMPLES - start) ? samples_read : (WAV_STREAM_RING_SAMPLES - start);
+
+  memcpy(out_samples, stream->ring + start, first_part * sizeof(float));
+  memcpy(out_samples + first_part, stream->ring, (samples_read - first_part) * sizeof(float));
+  memset(out_samples + samples_read, 0, (frames_count - frames_read) * channels * sizeof(float));
+
+  if(frames_read < frames_count && !stream->reached_end.load(std::memory_order_relaxed)) {
+    stream->underruns.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  stream->read_pos.store(read_pos + samples_read, std::memory_order_release);
+  return frames_read;
+}
+
+/// Returns `true` once the decode thread hit the end of the file _and_ the 
+/// audio callback consumed every frame left in the ring buffer.
+
+static bool wav_stream_is_finished(WavStream* stream) {
+  return stream->reached_end.load(std::memory_order_acquire) && 
+         stream->read_pos.load(std::memory_order_relaxed) == stream->write_pos.load(std::memory_order_acquire);
+}
+
+static void wav_stream_close(WavStream* stream) {
+  stream->is_running.store(false);
+  stream->decode_thread.join();
+
+  drwav_uninit(&stream->wav);
+}
+
+/// Usually, `drwav_init_file` will read the file through stdio and we then copy (and maybe convert) 
+/// the frames into a buffer of our own. But, if the WAV file is _already_ in the format 
+/// our mixer wants (16-bit PCM in this case), there is no reason to copy anything at all. 
+///
+/// Instead, we can memory-map the whole file and hand the mapping to `drwav_init_memory`. 
+/// dr_wav will then parse the headers and tell us _where_ the data chunk starts through 
+/// `drwav.dataChunkDataPos`. From there, the samples are just sitting in the mapping, 
+/// ready to be used. The OS will page them in as we touch them and share them between 
+/// every process that maps the same file.
+///
+/// If the format doesn't match, we fall back to `drwav_read_pcm_frames_s16` which converts 
+/// for us into a buffer we allocate.
+///
+/// The code below uses the POSIX `mmap`. On Windows, you can use `CreateFileMapping` and `MapViewOfFile` instead.
+
+struct WavMapping {
+  void* file_data; 
+  size_t file_size;
+
+  drwav wav;
+
+  /// Points either straight into `file_data` or into `converted_samples`.
+  const short* samples;
+  short* converted_samples;
+
+  drwav_uint64 frames_count;
+};
+
+static bool wav_mapping_open(WavMapping* mapping, const char* path) {
+  memset(mapping, 0, sizeof(WavMapping));
+
+  int fd = open(path, O_RDONLY);
+  if(fd == -1) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if(fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  mapping->file_size = (size_t)file_stat.st_size;
+  mapping->file_data = mmap(nullptr, mapping->file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  
+  // The mapping stays valid even after the file descriptor is closed.
+  close(fd);
+
+  if(mapping->file_data == MAP_FAILED) {
+    return false;
+  }
+
+  if(!drwav_init_memory(&mapping->wav, mapping->file_data, mapping->file_size, nullptr)) {
+    munmap(mapping->file_data, mapping->file_size);
+    return false;
+  }
+
+  mapping->frames_count = mapping->wav.totalPCMFrameCount;
+
+  /// The data is usable as-is only if it's 16-bit PCM, the data chunk actually fits inside 
+  /// the file (truncated files do exist), and the data starts at an address that is 
+  /// aligned to a `short`. It also has to be little-endian: RIFF, RF64, and Wave64 files are, 
+  /// but RIFX files (and AIFF, in newer versions of dr_wav) store their samples big-endian, so 
+  /// they go through the fallback path, which swaps the bytes for us. Likewise, on a big-endian 
+  /// machine you would always have to take the fallback path.
+
+  size_t data_size = (size_t)(mapping->frames_count * mapping->wav.channels * sizeof(short));
+
+  bool is_little_endian = mapping->wav.container == drwav_container_riff || 
+                          mapping->wav.container == drwav_container_rf64 || 
+                          mapping->wav.container == drwav_container_w64;
+
+  bool is_direct = is_little_endian && 
+                   mapping->wav.translatedFormatTag == DR_WAVE_FORMAT_PCM && 
+                   mapping->wav.bitsPerSample == 16 && 
+                   mapping->wav.dataChunkDataPos + data_size <= mapping->file_size && 
+                   (mapping->wav.dataChunkDataPos % sizeof(short)) == 0;
+
+  if(is_direct) {
+    mapping->samples = (const short*)((const unsigned char*)mapping->file_data + mapping->wav.dataChunkDataPos);
+    return true;
+  }
+
+  /// The fallback path. dr_wav converts whatever format the file has into 16-bit PCM. 
+
+  mapping->converted_samples = (short*)malloc(data_size);
+  if(!mapping->converted_samples) {
+    drwav_uninit(&mapping->wav);
+    munmap(mapping->file_data, mapping->file_size);
+    return false;
+  }
+
+  mapping->frames_count      = drwav_read_pcm_frames_s16(&mapping->wav, mapping->frames_count, mapping->converted_samples);
+  mapping->samples           = mapping->converted_samples;
+
+  return true;
+}
+
+static void wav_mapping_close(WavMapping* mapping) {
+  free(mapping->converted_samples); // Does nothing if we took the direct path
+
+  drwav_uninit(&mapping->wav);
+  munmap(mapping->file_data, mapping->file_size);
+}
+
+/// dr_wav can give us the frames as `short`s, `int`s, or `float`s. However, the mixer 
+/// on the other end usually wants one specific format, and converting between them 
+/// sample by sample on the audio thread adds up quickly. 
+///
+/// Below is a small set of conversion and (de)interleaving kernels. Each one comes in 
+/// three flavors: a plain scalar one that works everywhere, an SSE2 one, and an AVX2 one. 
+/// The SIMD flavors handle as many samples as they can in bulk and let the scalar 
+/// flavor take care of the leftovers at the tail. All three produce the exact same 
+/// results, since they clamp and round in the same way.
+///
+/// The `PcmConverter` struct is just a table of function pointers. We pick the best table 
+/// for the current CPU _once_ at startup with `pcm_converter_get`, and then call through it.
+///
+/// The conversions follow the same conventions as dr_wav:
+///
+///   - `short` covers [-32768, 32767] and maps to [-1.0f, 1.0f) by dividing by 32768.
+///   - `int` covers the full 32-bit range and maps to [-1.0f, 1.0f) by dividing by 2^31. 
+///   - `float` values outside of [-1.0f, 1.0f] are clamped (clipped) before converting back.
+
+struct PcmConverter {
+  const char* name;
+
+  void (*s16_to_f32)(const short* in, float* out, size_t samples_count);
+  void (*f32_to_s16)(const float* in, short* out, size_t samples_count);
+  void (*s32_to_f32)(const int* in, float* out, size_t samples_count);
+  void (*f32_to_s32)(const float* in, int* out, size_t samples_count);
+  void (*s16_to_s32)(const short* in, int* out, size_t samples_count);
+  void (*s32_to_s16)(const int* in, short* out, size_t samples_count);
+
+  /// Stereo is by far the most common layout, so it gets its own fast path. 
+  /// For any other channel count, use `pcm_interleave_f32` and `pcm_deinterleave_f32`.
+
+  void (*interleave_f32_stereo)(const float* left, const float* right, float* out, size_t frames_count);
+  void (*deinterleave_f32_stereo)(const float* in, float* left, float* right, size_t frames_count);
+};
+
+/// The largest `float` below 2^31. Anything at or above 2^31 would overflow an `int`.
+#define PCM_F32_TO_S32_MAX 2147483520.0f
+
+static void pcm_s16_to_f32_scalar(const short* in, float* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = in[i] * (1.0f / 32768.0f);
+  }
+}
+
+static void pcm_f32_to_s16_scalar(const float* in, short* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    float sample = fminf(fmaxf(in[i], -1.0f), 1.0f);
+    long value   = lrintf(sample * 32768.0f);
+
+    out[i] = (short)(value > 32767 ? 32767 : value);
+  }
+}
+
+static void pcm_s32_to_f32_scalar(const int* in, float* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = (float)in[i] * (1.0f / 2147483648.0f);
+  }
+}
+
+static void pcm_f32_to_s32_scalar(const float* in, int* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    float sample = fminf(fmaxf(in[i], -1.0f), 1.0f) * 2147483648.0f;
+    out[i]       = (int)lrintf(fminf(sample, PCM_F32_TO_S32_MAX));
+  }
+}
+
+static void pcm_s16_to_s32_scalar(const short* in, int* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = (int)((unsigned int)(unsigned short)in[i] << 16);
+  }
+}
+
+static void pcm_s32_to_s16_scalar(const int* in, short* out, size_t samples_count) {
+  for(size_t i = 0; i < samples_count; i++) {
+    out[i] = (short)(in[i] >> 16);
+  }
+}
+
+static void pcm_interleave_f32_stereo_scalar(const float* left, const float* right, float* out, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    out[i * 2 + 0] = left[i];
+    out[i * 2 + 1] = right[i];
+  }
+}
+
+static void pcm_deinterleave_f32_stereo_scalar(const float* in, float* left, float* right, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    left[i]  = in[i * 2 + 0];
+    right[i] = in[i * 2 + 1];
+  }
+}
+
+/// The generic versions for any channel count. `planes` is an array of `channels` pointers, one per channel.
+
+static void pcm_interleave_f32(const float* const* planes, float* out, size_t channels, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    for(size_t ch = 0; ch < channels; ch++) {
+      out[i * channels + ch] = planes[ch][i];
+    }
+  }
+}
+
+static void pcm_deinterleave_f32(const float* in, float* const* planes, size_t channels, size_t frames_count) {
+  for(size_t i = 0; i < frames_count; i++) {
+    for(size_t ch = 0; ch < channels; ch++) {
+      planes[ch][i] = in[i * channels + ch];
+    }
+  }
+}
+
+#if defined(PCM_HAS_X86)
+
+/// The SSE2 flavors. Every x86-64 CPU supports SSE2, so these never need a runtime check. 
+/// They process 8 samples (or 4 stereo frames) per iteration.
+
+static void pcm_s16_to_f32_sse2(const short* in, float* out, size_t samples_count) {
+  const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i values = _mm_loadu_si128((const __m128i*)(in + i));
+
+    // Sign-extending the shorts into ints by moving them to the top half and shifting back down.
+    __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+    __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+
+    _mm_storeu_ps(out + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s16_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_f32_to_s16_sse2(const float* in, short* out, size_t samples_count) {
+  const __m128 min   = _mm_set1_ps(-1.0f);
+  const __m128 max   = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128 low  = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 0), min), max), scale);
+    __m128 high = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), min), max), scale);
+
+    // `_mm_packs_epi32` saturates, so a clamped `1.0f` (32768) ends up as 32767.
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+    _mm_storeu_si128((__m128i*)(out + i), packed);
+  }
+
+  pcm_f32_to_s16_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_s32_to_f32_sse2(const int* in, float* out, size_t samples_count) {
+  const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i low  = _mm_loadu_si128((const __m128i*)(in + i + 0));
+    __m128i high = _mm_loadu_si128((const __m128i*)(in + i + 4));
+
+    _mm_storeu_ps(out + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s32_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_f32_to_s32_sse2(const float* in, int* out, size_t samples_count) {
+  const __m128 min        = _mm_set1_ps(-1.0f);
+  const __m128 max        = _mm_set1_ps(1.0f);
+  const __m128 scale      = _mm_set1_ps(2147483648.0f);
+  const __m128 scaled_max = _mm_set1_ps(PCM_F32_TO_S32_MAX);
+  size_t i = 0;
+
+  for(; i + 4 <= samples_count; i += 4) {
+    __m128 sample = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), min), max), scale);
+    _mm_storeu_si128((__m128i*)(out + i), _mm_cvtps_epi32(_mm_min_ps(sample, scaled_max)));
+  }
+
+  pcm_f32_to_s32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_s16_to_s32_sse2(const short* in, int* out, size_t samples_count) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i values = _mm_loadu_si128((const __m128i*)(in + i));
+
+    // Putting zeros in the bottom half is the same as shifting left by 16.
+    _mm_storeu_si128((__m128i*)(out + i + 0), _mm_unpacklo_epi16(zero, values));
+    _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(zero, values));
+  }
+
+  pcm_s16_to_s32_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_s32_to_s16_sse2(const int* in, short* out, size_t samples_count) {
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m128i low  = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(in + i + 0)), 16);
+    __m128i high = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(in + i + 4)), 16);
+
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(low, high));
+  }
+
+  pcm_s32_to_s16_scalar(in + i, out + i, samples_count - i);
+}
+
+static void pcm_interleave_f32_stereo_sse2(const float* left, const float* right, float* out, size_t frames_count) {
+  size_t i = 0;
+
+  for(; i + 4 <= frames_count; i += 4) {
+    __m128 l = _mm_loadu_ps(left + i);
+    __m128 r = _mm_loadu_ps(right + i);
+
+    _mm_storeu_ps(out + i * 2 + 0, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+  }
+
+  pcm_interleave_f32_stereo_scalar(left + i, right + i, out + i * 2, frames_count - i);
+}
+
+static void pcm_deinterleave_f32_stereo_sse2(const float* in, float* left, float* right, size_t frames_count) {
+  size_t i = 0;
+
+  for(; i + 4 <= frames_count; i += 4) {
+    __m128 a = _mm_loadu_ps(in + i * 2 + 0); // L0 R0 L1 R1
+    __m128 b = _mm_loadu_ps(in + i * 2 + 4); // L2 R2 L3 R3
+
+    _mm_storeu_ps(left + i,  _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+
+  pcm_deinterleave_f32_stereo_scalar(in + i * 2, left + i, right + i, frames_count - i);
+}
+
+/// The AVX2 flavors. These process 16 samples per iteration. Only the conversions that 
+/// actually benefit from the wider registers get an AVX2 flavor, the rest reuse the SSE2 ones.
+
+PCM_TARGET_AVX2 static void pcm_s16_to_f32_avx2(const short* in, float* out, size_t samples_count) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+  size_t i = 0;
+
+  for(; i + 16 <= samples_count; i += 16) {
+    __m256i low  = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 0)));
+    __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 8)));
+
+    _mm256_storeu_ps(out + i + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+    _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s16_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+PCM_TARGET_AVX2 static void pcm_f32_to_s16_avx2(const float* in, short* out, size_t samples_count) {
+  const __m256 min   = _mm256_set1_ps(-1.0f);
+  const __m256 max   = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(32768.0f);
+  size_t i = 0;
+
+  for(; i + 16 <= samples_count; i += 16) {
+    __m256 low  = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 0), min), max), scale);
+    __m256 high = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 8), min), max), scale);
+
+    // The AVX2 pack works on each 128-bit half separately, so we have to put the halves back in order.
+    __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(low), _mm256_cvtps_epi32(high));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+
+  pcm_f32_to_s16_scalar(in + i, out + i, samples_count - i);
+}
+
+PCM_TARGET_AVX2 static void pcm_s32_to_f32_avx2(const int* in, float* out, size_t samples_count) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+  size_t i = 0;
+
+  for(; i + 16 <= samples_count; i += 16) {
+    __m256i low  = _mm256_loadu_si256((const __m256i*)(in + i + 0));
+    __m256i high = _mm256_loadu_si256((const __m256i*)(in + i + 8));
+
+    _mm256_storeu_ps(out + i + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+    _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+  }
+
+  pcm_s32_to_f32_scalar(in + i, out + i, samples_count - i);
+}
+
+PCM_TARGET_AVX2 static void pcm_f32_to_s32_avx2(const float* in, int* out, size_t samples_count) {
+  const __m256 min        = _mm256_set1_ps(-1.0f);
+  const __m256 max        = _mm256_set1_ps(1.0f);
+  const __m256 scale      = _mm256_set1_ps(2147483648.0f);
+  const __m256 scaled_max = _mm256_set1_ps(PCM_F32_TO_S32_MAX);
+  size_t i = 0;
+
+  for(; i + 8 <= samples_count; i += 8) {
+    __m256 sample = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), min), max), scale);
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_cvtps_epi32(_mm256_min_ps(sample, scaled_max)));
+  }
+
+  pcm_f32_to_s32_scalar(in + i, out + i, samples_count - i);
+}
+
+/// Checking whether the CPU _and_ the OS support AVX2. The OS part matters, since the OS 
+/// has to save the wider registers when switching threads.
+
+static bool pcm_cpu_has_avx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+
+  bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+  if(!has_avx || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // PCM_HAS_X86
+
+static const PcmConverter PCM_CONVERTER_SCALAR = {
+  "scalar",
+  pcm_s16_to_f32_scalar, pcm_f32_to_s16_scalar, 
+  pcm_s32_to_f32_scalar, pcm_f32_to_s32_scalar, 
+  pcm_s16_to_s32_scalar, pcm_s32_to_s16_scalar,
+  pcm_interleave_f32_stereo_scalar, pcm_deinterleave_f32_stereo_scalar,
+};
+
+#if defined(PCM_HAS_X86)
+
+static const PcmConverter PCM_CONVERTER_SSE2 = {
+  "sse2",
+  pcm_s16_to_f32_sse2, pcm_f32_to_s16_sse2, 
+  pcm_s32_to_f32_sse2, pcm_f32_to_s32_sse2, 
+  pcm_s16_to_s32_sse2, pcm_s32_to_s16_sse2,
+  pcm_interleave_f32_stereo_sse2, pcm_deinterleave_f32_stereo_sse2,
+};
+
+static const PcmConverter PCM_CONVERTER_AVX2 = {
+  "avx2",
+  pcm_s16_to_f32_avx2, pcm_f32_to_s16_avx2, 
+  pcm_s32_to_f32_avx2, pcm_f32_to_s32_avx2, 
+  pcm_s16_to_s32_sse2, pcm_s32_to_s16_sse2,
+  pcm_interleave_f32_stereo_sse2, pcm_deinterleave_f32_stereo_sse2,
+};
+
+#endif // PCM_HAS_X86
+
+/// Returns the best converter table for the CPU we're running on.
+
+static const PcmConverter* pcm_converter_get() {
+#if defined(PCM_HAS_X86)
+  return pcm_cpu_has_avx2() ? &PCM_CONVERTER_AVX2 : &PCM_CONVERTER_SSE2;
+#else
+  return &PCM_CONVERTER_SCALAR;
+#endif
+}
+
+/// The loads at the top of `main` pass `nullptr` for the allocation callbacks, which means every 
+/// load goes through the global heap. That's fine for a couple of files. But, when a level 
+/// loads thousands of small sound effects, all of those tiny allocations and frees will 
+/// fragment the heap over time. 
+///
+/// Instead, we can give dr_wav our own allocator through the `drwav_allocation_callbacks` struct. 
+/// The allocator below is a simple "arena" (or "bump") allocator. It grabs one big block of 
+/// memory up front and hands out pieces of it by just bumping an offset. Freeing does nothing 
+/// (unless it's the very last allocation), and once a load is done, we "reset" the arena 
+/// by setting the offset back to zero. 
+///
+/// Each thread gets its own arena (see `audio_arena_get_thread`), so threads that load 
+/// sounds at the same time never have to share or lock anything. 
+///
+/// If an allocation doesn't fit in the arena, we fall back to the heap instead of failing, 
+/// and count it in `fallbacks_count` so you know the arena should be bigger.
+///
+/// The arena also keeps a few counters around. `bytes_allocated` and `allocations_count` 
+/// are per-load and get cleared on every reset. `high_water_mark` is the most memory a single 
+/// load has ever used, which is a good value to size the arena with.
+
+#define AUDIO_ARENA_CAPACITY  (4 * 1024 * 1024)
+#define AUDIO_ARENA_ALIGNMENT 16
+
+struct AudioArena {
+  unsigned char* memory; 
+  size_t capacity;
+  size_t offset; 
+  size_t last_offset; // Where the most recent allocation started
+
+  size_t bytes_allocated;
+  size_t allocations_count;
+  size_t fallbacks_count;
+  size_t high_water_mark;
+};
+
+/// Every allocation is preceded by a small header that stores its size, so that `realloc` 
+/// knows how much to copy. The header is as big as the alignment to keep the memory aligned.
+
+struct AudioArenaHeader {
+  size_t size;
+  unsigned char padding[AUDIO_ARENA_ALIGNMENT - sizeof(size_t)];
+};
+
+static bool audio_arena_owns(AudioArena* arena, void* ptr) {
+  return (unsigned char*)ptr >= arena->memory && (unsigned char*)ptr < arena->memory + arena->capacity;
+}
+
+static void* audio_arena_malloc(size_t size, void* user_data) {
+  AudioArena* arena = (AudioArena*)user_data;
+
+  size_t aligned_size = (size + (AUDIO_ARENA_ALIGNMENT - 1)) & ~(size_t)(AUDIO_ARENA_ALIGNMENT - 1);
+  size_t total_size   = sizeof(AudioArenaHeader) + aligned_size;
+
+  arena->allocations_count++;
+  arena->bytes_allocated += size;
+
+  // Not enough space left. Go to the heap instead.
+  if(arena->offset + total_size > arena->capacity) {
+    arena->fallbacks_count++;
+    return malloc(size);
+  }
+
+  AudioArenaHeader* header = (AudioArenaHeader*)(arena->memory + arena->offset);
+  header->size             = size;
+
+  arena->last_offset = arena->offset;
+  arena->offset     += total_size;
+
+  arena->high_water_mark = arena->offset > arena->high_water_mark ? arena->offset : arena->high_water_mark;
+  return header + 1;
+}
+
+static void audio_arena_free(void* ptr, void* user_data) {
+  AudioArena* arena = (AudioArena*)user_data;
+
+  if(!ptr) {
+    return;
+  }
+
+  if(!audio_arena_owns(arena, ptr)) {
+    free(ptr);
+    return;
+  }
+
+  // Only the most recent allocation can actually be given back. Everything else waits for the reset.
+  AudioArenaHeader* header = (AudioArenaHeader*)ptr - 1;
+  if((unsigned char*)header == arena->memory + arena->last_offset) {
+    arena->offset = arena->last_offset;
+  }
+}
+
+static void* audio_arena_realloc(void* ptr, size_t new_size, void* user_data) {
+  AudioArena* arena = (AudioArena*)user_data;
+
+  if(!ptr) {
+    return audio_arena_malloc(new_size, user_data);
+  }
+
+  if(!audio_arena_owns(arena, ptr)) {
+    return realloc(ptr, new_size);
+  }
+
+  AudioArenaHeader* header = (AudioArenaHeader*)ptr - 1;
+  size_t old_size          = header->size;
+
+  // If it's the most recent allocation and there's room, we can just grow it in place.
+  if((unsigned char*)header == arena->memory + arena->last_offset) {
+    size_t aligned_size = (new_size + (AUDIO_ARENA_ALIGNMENT - 1)) & ~(size_t)(AUDIO_ARENA_ALIGNMENT - 1);
+    size_t new_offset   = arena->last_offset + sizeof(AudioArenaHeader) + aligned_size;
+
+    if(new_offset <= arena->capacity) {
+      arena->bytes_allocated += new_size > old_size ? new_size - old_size : 0;
+      arena->offset           = new_offset;
+      arena->high_water_mark  = new_offset > arena->high_water_mark ? new_offset : arena->high_water_mark;
+
+      header->size = new_size;
+      return ptr;
+    }
+  }
+
+  void* new_ptr = audio_arena_malloc(new_size, user_data);
+  if(new_ptr) {
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  }
+
+  return new_ptr;
+}
+
+/// Call this once a load is done _and_ you've finished with every pointer dr_wav gave you 
+/// during that load (including the samples buffer returned by the `_open_file_and_read_pcm_frames_*` 
+/// functions). Make sure to copy out anything you want to keep before resetting.
+
+static void audio_arena_reset(AudioArena* arena) {
+  arena->offset            = 0;
+  arena->last_offset       = 0;
+  arena->bytes_allocated   = 0;
+  arena->allocations_count = 0;
+  arena->fallbacks_count   = 0;
+}
+
+/// Returns the arena of the calling thread, creating it the first time it's used on that thread. 
+/// The memory of the arena is given back when the thread exits.
+
+struct AudioArenaOwner {
+  AudioArena arena = {};
+
+  ~AudioArenaOwner() {
+    free(arena.memory);
+  }
+};
+
+static AudioArena* audio_arena_get_thread() {
+  static thread_local AudioArenaOwner owner;
+
+  if(!owner.arena.memory) {
+    owner.arena.memory   = (unsigned char*)malloc(AUDIO_ARENA_CAPACITY);
+    owner.arena.capacity = AUDIO_ARENA_CAPACITY;
+  }
+
+  return &owner.arena;
+}
+
+/// Finally, the callbacks we actually hand over to dr_wav. The `pUserData` is the arena itself.
+
+static drwav_allocation_callbacks audio_arena_callbacks(AudioArena* arena) {
+  drwav_allocation_callbacks callbacks;
+  callbacks.pUserData = arena;
+  callbacks.onMalloc  = audio_arena_malloc;
+  callbacks.onRealloc = audio_arena_realloc;
+  callbacks.onFree    = audio_arena_free;
+
+  return callbacks;
+}
+
+/// A small helper to retrieve the peak resident memory (RSS) of the process in kilobytes. 
+/// On Windows, you can use `GetProcessMemoryInfo` and the `PeakWorkingSetSize` member instead.
+
+static long get_peak_rss_kb() {
+  rusage usage; 
+  getrusage(RUSAGE_SELF, &usage);
+
+  return usage.ru_maxrss;
+}
+
 int main() {
+  /// Before anything else, let's see the streaming path from above in action. We'll compare it to 
+  /// the full-load path further down. 
+  ///
+  /// We simulate an audio callback that asks for 512 frames at a time, and we measure how long 
+  /// each "callback" takes as well as the peak memory of the process. The streaming path is 
+  /// measured right at the start of `main`, before anything in this file decodes a whole WAV 
+  /// file, since the peak RSS can only ever go up. If anything had fully loaded the file first, 
+  /// its peak would hide the streaming one. 
+  ///
+  /// Keep in mind that a real audio callback is called by the audio device at a fixed rate. 
+  /// Here, we just call it as fast as we can, which is the worst case for the decode thread.
+
+  const size_t callback_frames = 512;
+  float callback_buffer[callback_frames * WAV_STREAM_MAX_CHANNELS];
+
+  /// The streaming path. Notice that this struct does not grow with the size of the file. 
+  /// It's also quite big to live on the stack, so we allocate it.
+
+  long startup_rss_kb = get_peak_rss_kb();
+
+  WavStream* stream = new WavStream;
+  if(!wav_stream_open(stream, "path/to/audio.wav", false)) {
+    printf("ERROR: Could not open WAV stream!\n");
+    return -1;
+  }
+
+  double stream_max_us = 0.0, stream_total_us = 0.0;
+  size_t stream_callbacks = 0;
+
+  while(!wav_stream_is_finished(stream)) {
+    auto start = std::chrono::steady_clock::now();
+    wav_stream_read(stream, callback_buffer, callback_frames);
+    double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    stream_total_us += elapsed_us;
+    stream_max_us    = elapsed_us > stream_max_us ? elapsed_us : stream_max_us;
+    stream_callbacks++;
+  }
+
+  printf("STREAMING: peak RSS = %ld KB (%ld KB at startup), callback avg = %.3f us, max = %.3f us, underruns = %zu\n", 
+         get_peak_rss_kb(), startup_rss_kb, stream_total_us / stream_callbacks, stream_max_us, stream->underruns.load());
+
+  wav_stream_close(stream);
+  delete stream;
+
   /// In order to load a WAV file using dr_wav, you can call the function 
   /// below with the specific path to the WAV file. The function will 
   /// fill a useful `drwav` struct that can be used later for reading 
@@ -105,4 +981,182 @@ int main() {
   /// this function below to deallocate the samples buffer.
 
   drwav_free(samples);
+
+  /// Now, the full-load path, to compare against the streaming one from the start of `main`. 
+  /// Everything is decoded up front, and the "callback" is just a copy out of the big buffer. 
+  /// Its peak RSS includes the whole-file decodes above, which are just as big as this one.
+
+  unsigned int full_channels, full_sample_rate;
+  drwav_uint64 full_frames;
+
+  float* full_samples = drwav_open_file_and_read_pcm_frames_f32("path/to/audio.wav", &full_channels, &full_sample_rate, &full_frames, nullptr);
+  if(!full_samples || full_channels > WAV_STREAM_MAX_CHANNELS) {
+    printf("ERROR: Could not load WAV file!\n");
+    drwav_free(full_samples);
+    return -1;
+  }
+
+  double full_max_us = 0.0, full_total_us = 0.0;
+  size_t full_callbacks = 0;
+
+  for(drwav_uint64 frame = 0; frame < full_frames; frame += callback_frames) {
+    size_t frames_to_copy = (full_frames - frame) < callback_frames ? (size_t)(full_frames - frame) : callback_frames;
+
+    auto start = std::chrono::steady_clock::now();
+    memcpy(callback_buffer, full_samples + frame * full_channels, frames_to_copy * full_channels * sizeof(float));
+    double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    full_total_us += elapsed_us;
+    full_max_us    = elapsed_us > full_max_us ? elapsed_us : full_max_us;
+    full_callbacks++;
+  }
+
+  printf("FULL LOAD: peak RSS = %ld KB, callback avg = %.3f us, max = %.3f us\n", 
+         get_peak_rss_kb(), full_total_us / full_callbacks, full_max_us);
+
+  drwav_free(full_samples);
+
+  /// And here is the memory-mapped loader from above. If the WAV file is 16-bit PCM, 
+  /// `mapping.samples` will point straight into the file's data chunk with no copies made. 
+  /// Otherwise, it will point to a converted copy. Either way, you use it the same way.
+
+  WavMapping mapping;
+  if(!wav_mapping_open(&mapping, "path/to/audio.wav")) {
+    printf("ERROR: Could not map WAV file!\n");
+    return -1;
+  }
+
+  printf("MAPPED: %llu frames, %s\n", 
+         (unsigned long long)mapping.frames_count, mapping.converted_samples ? "converted" : "zero-copy");
+
+  wav_mapping_close(&mapping);
+
+  /// Finally, let's use the conversion kernels from above and see how fast each flavor is. 
+  ///
+  /// In a real program, you would just call `pcm_converter_get` once and use the returned table 
+  /// right after the `drwav_read_pcm_frames_*` call. For example, to read `short`s and hand `float`s to 
+  /// the mixer:
+  ///
+  ///   converter->s16_to_f32(s16_samples_buffer, f32_samples_buffer, frames_read * wav.channels);
+  ///
+  /// Here, though, we run every flavor over the same buffer and print the samples per second of each one.
+
+  const PcmConverter* converter = pcm_converter_get();
+  printf("PCM CONVERTER: using '%s'\n", converter->name);
+
+  const PcmConverter* converters[] = {
+    &PCM_CONVERTER_SCALAR,
+#if defined(PCM_HAS_X86)
+    &PCM_CONVERTER_SSE2,
+    converter == &PCM_CONVERTER_AVX2 ? &PCM_CONVERTER_AVX2 : nullptr,
+#endif
+  };
+
+  const size_t bench_samples    = 1 << 20;
+  const int bench_iterations    = 50;
+
+  short* bench_s16 = (short*)malloc(bench_samples * sizeof(short));
+  int* bench_s32   = (int*)malloc(bench_samples * sizeof(int));
+  float* bench_f32 = (float*)malloc(bench_samples * sizeof(float));
+  float* bench_l   = (float*)malloc(bench_samples / 2 * sizeof(float));
+  float* bench_r   = (float*)malloc(bench_samples / 2 * sizeof(float));
+
+  for(size_t i = 0; i < bench_samples; i++) {
+    bench_f32[i] = sinf((float)i * 0.01f) * 1.1f; // Slightly over 1.0f to exercise the clipping as well
+  }
+
+  for(const PcmConverter* conv : converters) {
+    if(!conv) {
+      continue;
+    }
+
+    auto bench = [&](const char* label, auto&& convert) {
+      auto start = std::chrono::steady_clock::now();
+      for(int i = 0; i < bench_iterations; i++) {
+        convert();
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      printf("  [%-6s] %-24s %8.1f Msamples/sec\n", conv->name, label, (bench_samples * bench_iterations) / seconds / 1e6);
+    };
+
+    bench("f32 -> s16", [&]() { conv->f32_to_s16(bench_f32, bench_s16, bench_samples); });
+    bench("s16 -> f32", [&]() { conv->s16_to_f32(bench_s16, bench_f32, bench_samples); });
+    bench("f32 -> s32", [&]() { conv->f32_to_s32(bench_f32, bench_s32, bench_samples); });
+    bench("s32 -> f32", [&]() { conv->s32_to_f32(bench_s32, bench_f32, bench_samples); });
+    bench("s16 -> s32", [&]() { conv->s16_to_s32(bench_s16, bench_s32, bench_samples); });
+    bench("s32 -> s16", [&]() { conv->s32_to_s16(bench_s32, bench_s16, bench_samples); });
+    bench("deinterleave (stereo)", [&]() { conv->deinterleave_f32_stereo(bench_f32, bench_l, bench_r, bench_samples / 2); });
+    bench("interleave (stereo)", [&]() { conv->interleave_f32_stereo(bench_l, bench_r, bench_f32, bench_samples / 2); });
+  }
+
+  /// The generic (de)interleavers don't have SIMD flavors, since the channel count isn't known up front. 
+  /// Here they are on 5.1 audio (6 channels), for comparison with the stereo fast path above.
+
+  const size_t surround_channels = 6;
+  const size_t surround_frames   = bench_samples / surround_channels;
+
+  float* surround_planes_data = (float*)malloc(surround_frames * surround_channels * sizeof(float));
+  float* surround_planes[surround_channels];
+  for(size_t ch = 0; ch < surround_channels; ch++) {
+    surround_planes[ch] = surround_planes_data + ch * surround_frames;
+  }
+
+  auto surround_start = std::chrono::steady_clock::now();
+  for(int i = 0; i < bench_iterations; i++) {
+    pcm_deinterleave_f32(bench_f32, surround_planes, surround_channels, surround_frames);
+  }
+  double surround_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - surround_start).count();
+  printf("  [%-6s] %-24s %8.1f Msamples/sec\n", "scalar", "deinterleave (5.1)", (surround_frames * surround_channels * bench_iterations) / surround_seconds / 1e6);
+
+  surround_start = std::chrono::steady_clock::now();
+  for(int i = 0; i < bench_iterations; i++) {
+    pcm_interleave_f32(surround_planes, bench_f32, surround_channels, surround_frames);
+  }
+  surround_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - surround_start).count();
+  printf("  [%-6s] %-24s %8.1f Msamples/sec\n", "scalar", "interleave (5.1)", (surround_frames * surround_channels * bench_iterations) / surround_seconds / 1e6);
+
+  free(surround_planes_data);
+
+  free(bench_s16);
+  free(bench_s32);
+  free(bench_f32);
+  free(bench_l);
+  free(bench_r);
+
+  /// Here is the arena allocator from above in action. We load a list of sound effects, 
+  /// one after the other, all on the same thread. Each load allocates from the thread's 
+  /// arena and, once we're done with the samples, we reset the arena for the next load. 
+  /// No matter how many files we load, the heap is never touched (unless the arena overflows).
+
+  const char* sfx_paths[] = {
+    "path/to/footstep.wav",
+    "path/to/gunshot.wav",
+    "path/to/explosion.wav",
+  };
+
+  AudioArena* arena                       = audio_arena_get_thread();
+  drwav_allocation_callbacks arena_allocs = audio_arena_callbacks(arena);
+
+  for(const char* sfx_path : sfx_paths) {
+    unsigned int sfx_channels, sfx_sample_rate;
+    drwav_uint64 sfx_frames;
+
+    float* sfx_samples = drwav_open_file_and_read_pcm_frames_f32(sfx_path, &sfx_channels, &sfx_sample_rate, &sfx_frames, &arena_allocs);
+    if(!sfx_samples) {
+      printf("ERROR: Could not load '%s'!\n", sfx_path);
+      audio_arena_reset(arena);
+      continue;
+    }
+
+    // ... Copy `sfx_samples` into your sound bank or hand them to the mixer here ...
+
+    printf("ARENA: '%s' -> %zu bytes in %zu allocations (%zu fallbacks)\n", 
+           sfx_path, arena->bytes_allocated, arena->allocations_count, arena->fallbacks_count);
+
+    drwav_free(sfx_samples, &arena_allocs);
+    audio_arena_reset(arena);
+  }
+
+  printf("ARENA: high-water mark = %zu bytes\n", arena->high_water_mark);
 }
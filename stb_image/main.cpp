@@ -1,11 +1,1335 @@
+#include <cstddef>
+
+/// stb_image lets us replace its allocator by defining `STBI_MALLOC`, `STBI_REALLOC_SIZED`, and `STBI_FREE` 
+/// _before_ including it. We route them to the per-load arena further down (see `image_load_arena`). 
+/// Outside of an arena load, they behave exactly like `malloc`, `realloc`, and `free`.
+///
+/// `STBI_REALLOC_SIZED` is the variant of `STBI_REALLOC` that also gets the old size. stb_image calls 
+/// it whenever it grows a buffer (the zlib output of a PNG, for example), and an arena needs the old 
+/// size to know how much to copy. Defining it means stb_image never uses plain `STBI_REALLOC`.
+
+static void* image_arena_malloc(size_t size);
+static void* image_arena_realloc(void* ptr, size_t old_size, size_t new_size);
+static void image_arena_free(void* ptr);
+
+#define STBI_MALLOC(size)                           image_arena_malloc(size)
+#define STBI_REALLOC_SIZED(ptr, old_size, new_size) image_arena_realloc(ptr, old_size, new_size)
+#define STBI_FREE(ptr)                              image_arena_free(ptr)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <cmath>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define IMAGE_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
 
 /// You can find the stb_image library at the link below: 
 ///
 /// https://github.com/nothings/stb
+///
+/// stb_image_write lives in the same repository. It's only used to generate the images for the benchmarks.
+
+/// `stbi_load` opens the file with stdio, which reads the file into stdio's buffer, and then 
+/// stb_image copies it again into its own buffer. There are two other ways of giving stb_image 
+/// the bytes of an image that skip stdio altogether.
+///
+/// The first is `stbi_load_from_memory`. If we memory-map the file, the OS hands us a pointer to 
+/// the file's contents and pages them in as stb_image reads them. No reads, no copies.
+///
+/// The code below uses the POSIX `mmap`. On Windows, you can use `CreateFileMapping` and `MapViewOfFile` instead.
+
+struct MappedFile {
+  const unsigned char* data; 
+  size_t size;
+};
+
+static bool map_file(const char* path, MappedFile* mapped) {
+  int fd = open(path, O_RDONLY);
+  if(fd == -1) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if(fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping stays valid even after the file descriptor is closed
+
+  if(data == MAP_FAILED) {
+    return false;
+  }
+
+  mapped->data = (const unsigned char*)data;
+  mapped->size = (size_t)file_stat.st_size;
+  return true;
+}
+
+static void unmap_file(MappedFile* mapped) {
+  munmap((void*)mapped->data, mapped->size);
+}
+
+/// The second is `stbi_load_from_callbacks`, where stb_image asks _us_ for bytes through 
+/// the `stbi_io_callbacks` struct: 
+///
+///   - `read` fills `data` with up to `size` bytes and returns how many it actually wrote. 
+///   - `skip` skips `n` bytes (`n` can be negative, which means going back). 
+///   - `eof` returns non-zero once there's nothing left to read.
+///
+/// This is exactly what you want for images inside a packed archive (one big file with many 
+/// assets in it). The reader below reads one entry of an archive, given the entry's offset and size, 
+/// using `pread` straight into stb_image's buffer. Many readers can share the same file descriptor, 
+/// since `pread` doesn't move any shared file position. On Windows, `ReadFile` with an `OVERLAPPED` 
+/// offset does the same thing.
+///
+/// stb_image only asks for 128 bytes at a time, though, and formats like BMP are read almost byte 
+/// by byte. One `pread` per request would be one system call per 128 bytes. So, the reader keeps 
+/// a read-ahead buffer of `ARCHIVE_READ_AHEAD_SIZE` bytes, and serves small requests out of it. 
+/// Requests that are at least as big as the buffer skip it and go straight to `pread`.
+
+#define ARCHIVE_READ_AHEAD_SIZE (64 * 1024)
+
+struct ArchiveEntryReader {
+  int fd; 
+  size_t entry_offset; // Where the entry starts in the archive
+  size_t entry_size;
+  size_t position;     // Where we are inside the entry
+
+  size_t buffer_position; // Where in the entry the buffer starts
+  size_t buffer_size;     // How many bytes of the buffer are valid
+  unsigned char buffer[ARCHIVE_READ_AHEAD_SIZE];
+};
+
+/// The reader is a bit big for the stack, so you'll usually allocate one and reuse it for every entry.
+
+static void archive_entry_reader_init(ArchiveEntryReader* reader, int fd, size_t entry_offset, size_t entry_size) {
+  reader->fd              = fd;
+  reader->entry_offset    = entry_offset;
+  reader->entry_size      = entry_size;
+  reader->position        = 0;
+  reader->buffer_position = 0;
+  reader->buffer_size     = 0;
+}
+
+static int archive_entry_read(void* user, char* data, int size) {
+  ArchiveEntryReader* reader = (ArchiveEntryReader*)user;
+
+  size_t remaining = reader->entry_size - reader->position;
+  size_t to_read   = (size_t)size < remaining ? (size_t)size : remaining;
+  size_t copied    = 0;
+
+  while(copied < to_read) {
+    bool is_in_buffer = reader->position >= reader->buffer_position && 
+                        reader->position < reader->buffer_position + reader->buffer_size;
+
+    if(!is_in_buffer) {
+      off_t file_offset = (off_t)(reader->entry_offset + reader->position);
+
+      // A big request. Going through the buffer would only add a copy.
+      if(to_read - copied >= ARCHIVE_READ_AHEAD_SIZE) {
+        ssize_t bytes_read = pread(reader->fd, data + copied, to_read - copied, file_offset);
+        if(bytes_read <= 0) {
+          break;
+        }
+
+        copied           += (size_t)bytes_read;
+        reader->position += (size_t)bytes_read;
+        continue;
+      }
+
+      size_t to_fill     = reader->entry_size - reader->position;
+      to_fill            = to_fill < ARCHIVE_READ_AHEAD_SIZE ? to_fill : ARCHIVE_READ_AHEAD_SIZE;
+      ssize_t bytes_read = pread(reader->fd, reader->buffer, to_fill, file_offset);
+      if(bytes_read <= 0) {
+        break;
+      }
+
+      reader->buffer_position = reader->position;
+      reader->buffer_size     = (size_t)bytes_read;
+    }
+
+    size_t buffer_offset = reader->position - reader->buffer_position;
+    size_t chunk         = reader->buffer_size - buffer_offset;
+    chunk                = chunk < (to_read - copied) ? chunk : (to_read - copied);
+
+    memcpy(data + copied, reader->buffer + buffer_offset, chunk);
+    copied           += chunk;
+    reader->position += chunk;
+  }
+
+  return (int)copied;
+}
+
+static void archive_entry_skip(void* user, int n) {
+  ArchiveEntryReader* reader = (ArchiveEntryReader*)user;
+
+  long long position = (long long)reader->position + n;
+  position           = position < 0 ? 0 : position;
+  reader->position   = (size_t)position > reader->entry_size ? reader->entry_size : (size_t)position;
+}
+
+static int archive_entry_eof(void* user) {
+  ArchiveEntryReader* reader = (ArchiveEntryReader*)user;
+  return reader->position >= reader->entry_size;
+}
+
+static const stbi_io_callbacks ARCHIVE_ENTRY_CALLBACKS = {
+  archive_entry_read, 
+  archive_entry_skip, 
+  archive_entry_eof,
+};
+
+/// Every launch, we decode the very same textures again, paying for all of the PNG inflating and 
+/// JPG decoding each time. But if the file didn't change, neither do the pixels. So, the first 
+/// time we decode an image, we can save the decoded pixels to a cache on disk, in a raw format 
+/// that can be memory-mapped and used directly. The next time, we just map the cached pixels.
+///
+/// The cache is "content-addressed": the name of each cached file is a hash of the _bytes_ of the 
+/// source image, plus the requested channels and whether we want `float`s. If the source image changes, 
+/// so does its hash, and we simply miss the cache. We still have to read the source bytes to hash 
+/// them, but hashing is a lot cheaper than decoding.
+///
+/// Each cached file is a small header followed by the pixels. The header is padded to 64 bytes 
+/// so the pixels are nicely aligned when mapped. 
+
+#define IMAGE_CACHE_VERSION 1
+
+struct ImageCacheHeader {
+  char magic[4]; // Always "IMGC"
+  int version;
+  int width; 
+  int height; 
+  int channels; 
+  int is_float;
+  unsigned long long data_size;
+  unsigned char padding[32];
+};
+
+struct ImageCache {
+  const char* directory; 
+
+  std::atomic<int> hits; 
+  std::atomic<int> misses;
+};
+
+/// An image that came out of the cache. On a hit, `pixels` points into the mapped cache file. 
+/// On a miss, it's the buffer stb_image gave us. Either way, give it back with `image_cache_release`.
+
+struct CachedImage {
+  const void* pixels; 
+  int width; 
+  int height; 
+  int channels;
+
+  MappedFile cache_file; // Only valid on a hit
+  bool is_mapped;
+};
+
+/// A 64-bit FNV-1a hash over the whole file. It's not cryptographic, but it's plenty to tell textures apart.
+
+static unsigned long long image_hash_bytes(const unsigned char* bytes, size_t size) {
+  unsigned long long hash = 14695981039346656037ull;
+
+  for(size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static void image_cache_init(ImageCache* cache, const char* directory) {
+  cache->directory = directory;
+  cache->hits.store(0);
+  cache->misses.store(0);
+
+  mkdir(directory, 0755); // Fails harmlessly if the directory is already there
+}
+
+/// Loads the image at `path` through the cache. With `as_float`, the image is loaded with `stbi_loadf`, 
+/// otherwise with `stbi_load`. The `desired_channels` works the same as with those functions.
+
+static bool image_cache_load(ImageCache* cache, const char* path, int desired_channels, bool as_float, CachedImage* image) {
+  MappedFile source;
+  if(!map_file(path, &source)) {
+    return false;
+  }
+
+  char cache_path[1024];
+  snprintf(cache_path, sizeof(cache_path), "%s/%016llx_%i_%s.raw", 
+           cache->directory, image_hash_bytes(source.data, source.size), desired_channels, as_float ? "f32" : "u8");
+
+  /// Trying the cache first. Any mismatch in the header (a different version, or a file that got 
+  /// cut short) just counts as a miss.
+
+  image->is_mapped = map_file(cache_path, &image->cache_file);
+  if(image->is_mapped) {
+    const ImageCacheHeader* header = (const ImageCacheHeader*)image->cache_file.data;
+
+    bool is_valid = image->cache_file.size >= sizeof(ImageCacheHeader) && 
+                    memcmp(header->magic, "IMGC", 4) == 0 && 
+                    header->version == IMAGE_CACHE_VERSION && 
+                    image->cache_file.size == sizeof(ImageCacheHeader) + header->data_size;
+
+    if(is_valid) {
+      image->pixels   = image->cache_file.data + sizeof(ImageCacheHeader);
+      image->width    = header->width;
+      image->height   = header->height;
+      image->channels = header->channels;
+
+      cache->hits.fetch_add(1, std::memory_order_relaxed);
+      unmap_file(&source);
+      return true;
+    }
+
+    unmap_file(&image->cache_file);
+    image->is_mapped = false;
+  }
+
+  cache->misses.fetch_add(1, std::memory_order_relaxed);
+
+  /// A miss. Decoding the image from the mapped source and saving the pixels for next time. 
+  /// We write to a temporary file first and then rename it, so that a crash (or another 
+  /// process reading the cache) never sees a half-written file. The temporary name is unique 
+  /// per process and per write, since other threads may be loading the same image right now.
+
+  int channels_in_file;
+  image->pixels = as_float ? (const void*)stbi_loadf_from_memory(source.data, (int)source.size, &image->width, &image->height, &channels_in_file, desired_channels)
+                           : (const void*)stbi_load_from_memory(source.data, (int)source.size, &image->width, &image->height, &channels_in_file, desired_channels);
+  unmap_file(&source);
+
+  if(!image->pixels) {
+    return false;
+  }
+
+  image->channels = desired_channels != 0 ? desired_channels : channels_in_file;
+
+  ImageCacheHeader header = {};
+  memcpy(header.magic, "IMGC", 4);
+  header.version   = IMAGE_CACHE_VERSION;
+  header.width     = image->width;
+  header.height    = image->height;
+  header.channels  = image->channels;
+  header.is_float  = as_float;
+  header.data_size = (unsigned long long)image->width * image->height * image->channels * (as_float ? sizeof(float) : 1);
+
+  static std::atomic<unsigned int> temp_counter(0);
+
+  char temp_path[1100];
+  snprintf(temp_path, sizeof(temp_path), "%s.%d.%u.tmp", cache_path, (int)getpid(), temp_counter.fetch_add(1, std::memory_order_relaxed));
+
+  FILE* file = fopen(temp_path, "wb");
+  if(file) {
+    bool is_written = fwrite(&header, sizeof(header), 1, file) == 1 && 
+                      fwrite(image->pixels, 1, header.data_size, file) == header.data_size;
+    is_written      = fclose(file) == 0 && is_written;
+
+    if(is_written) {
+      rename(temp_path, cache_path);
+    }
+    else {
+      remove(temp_path);
+    }
+  }
+
+  return true;
+}
+
+static void image_cache_release(CachedImage* image) {
+  if(image->is_mapped) {
+    unmap_file(&image->cache_file);
+  }
+  else {
+    stbi_image_free((void*)image->pixels);
+  }
+}
+
+/// The `stbi_hdr_to_ldr_*` and `stbi_ldr_to_hdr_*` functions we used in `main` set _global_ state. 
+/// Every load on every thread shares the same gamma and scale, so two threads that want different 
+/// settings would have to take turns behind a lock. 
+///
+/// But we don't actually need stb_image to do the conversion for us. An HDR file loaded with 
+/// `stbi_loadf` comes back as-is, and an LDR file loaded with `stbi_load` comes back as-is too. The 
+/// conversions only kick in when we cross over (LDR with `stbi_loadf`, or HDR with `stbi_load`). 
+/// So, the loaders below always load images in their _native_ format, and then convert them with 
+/// a gamma and scale given _per call_. No global state involved, and any thread can use any settings.
+///
+/// The conversions are the same ones stb_image does:
+///
+///   - HDR -> LDR: `ldr = pow(hdr / scale, 1 / gamma) * 255`
+///   - LDR -> HDR: `hdr = pow(ldr / 255, gamma) * scale`
+///
+/// The alpha channel (the last channel, when there are 2 or 4 channels) is never gamma-corrected. 
+///
+/// LDR -> HDR only ever sees 256 different inputs, so instead of a vectorized `pow`, we compute all 
+/// 256 results once per call and just look them up. HDR -> LDR has to deal with any `float`, so it 
+/// uses an SSE2 `pow` built from `log2` and `exp2` approximations: `pow(x, y) = exp2(y * log2(x))`. 
+/// Both approximations are accurate to a few millionths, far below what 8 bits can tell apart.
+
+struct ImageToneParams {
+  float gamma; // 2.2f by default in stb_image
+  float scale; // 1.0f by default in stb_image
+};
+
+/// LDR -> HDR. `out` must have room for `pixels_count * channels` `float`s.
+
+static void image_ldr_to_hdr(const unsigned char* in, float* out, size_t pixels_count, int channels, ImageToneParams params) {
+  float table[256];
+  for(int i = 0; i < 256; i++) {
+    table[i] = powf(i / 255.0f, params.gamma) * params.scale;
+  }
+
+  int color_channels = (channels % 2) ? channels : channels - 1; 
+
+  for(size_t i = 0; i < pixels_count; i++) {
+    for(int ch = 0; ch < color_channels; ch++) {
+      out[i * channels + ch] = table[in[i * channels + ch]];
+    }
+
+    if(color_channels != channels) {
+      out[i * channels + color_channels] = in[i * channels + color_channels] / 255.0f;
+    }
+  }
+}
+
+#if defined(IMAGE_HAS_SSE2)
+
+/// `log2(x)` for `x > 0`. The exponent bits give the integer part, and a polynomial over the 
+/// mantissa (which is in [1, 2)) gives the fractional part.
+
+static inline __m128 image_log2_sse2(__m128 x) {
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  __m128i bits     = _mm_castps_si128(x);
+  __m128 exponent  = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+  __m128 mantissa  = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF))), one);
+  __m128 t         = _mm_sub_ps(mantissa, one);
+
+  __m128 poly = _mm_set1_ps(-0.024827667678380905f);
+  poly = _mm_add_ps(_mm_mul_ps(poly, t), _mm_set1_ps(0.11791432691105105f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, t), _mm_set1_ps(-0.27236769323723076f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, t), _mm_set1_ps(0.453866932162381f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, t), _mm_set1_ps(-0.7169906462410045f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, t), _mm_set1_ps(1.4423960607022455f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, t), _mm_set1_ps(5.0381227923309635e-06f));
+
+  return _mm_add_ps(exponent, poly);
+}
+
+/// `exp2(x)` for `x` in [-126, 1]. The integer part goes straight into the exponent bits, and a 
+/// polynomial takes care of the fractional part.
+
+static inline __m128 image_exp2_sse2(__m128 x) {
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  // SSE2 has no floor, so we truncate and then fix up the negative values.
+  __m128 whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+  whole        = _mm_sub_ps(whole, _mm_and_ps(_mm_cmpgt_ps(whole, x), one));
+  __m128 f     = _mm_sub_ps(x, whole);
+
+  __m128 poly = _mm_set1_ps(0.001894383600174327f);
+  poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.00894060183812149f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.05587650682745259f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.24013172779315783f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.6931567673921265f));
+  poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.9999997703130964f));
+
+  __m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(whole), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(poly, _mm_castsi128_ps(exponent));
+}
+
+#endif // IMAGE_HAS_SSE2
+
+/// HDR -> LDR. `out` must have room for `pixels_count * channels` bytes.
+
+static void image_hdr_to_ldr(const float* in, unsigned char* out, size_t pixels_count, int channels, ImageToneParams params) {
+  float inv_scale = 1.0f / params.scale;
+  float inv_gamma = 1.0f / params.gamma;
+
+  size_t samples_count = pixels_count * channels;
+  size_t i = 0;
+
+#if defined(IMAGE_HAS_SSE2)
+  const __m128 scale_v     = _mm_set1_ps(inv_scale);
+  const __m128 gamma_v     = _mm_set1_ps(inv_gamma);
+  const __m128 tiny        = _mm_set1_ps(1e-30f); // Keeps `log2` away from zero and negative values
+  const __m128 min_power   = _mm_set1_ps(-126.0f);
+  const __m128 max_power   = _mm_set1_ps(1.0f);   // Anything above 1.0f ends up clamped to 255 anyway
+  const __m128 max_value   = _mm_set1_ps(255.0f);
+  const __m128 half        = _mm_set1_ps(0.5f);
+
+  for(; i + 4 <= samples_count; i += 4) {
+    __m128 value = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale_v), tiny);
+    __m128 power = _mm_min_ps(_mm_max_ps(_mm_mul_ps(image_log2_sse2(value), gamma_v), min_power), max_power);
+    __m128 ldr   = _mm_add_ps(_mm_mul_ps(image_exp2_sse2(power), max_value), half);
+
+    __m128i ints   = _mm_cvttps_epi32(_mm_min_ps(ldr, max_value));
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(ints, ints), _mm_setzero_si128());
+
+    int four_bytes = _mm_cvtsi128_si32(packed);
+    memcpy(out + i, &four_bytes, 4);
+  }
+#endif
+
+  // Whatever is left over (or everything, without SSE2).
+  for(; i < samples_count; i++) {
+    float value = in[i] * inv_scale;
+    float ldr   = value > 0.0f ? powf(value, inv_gamma) * 255.0f + 0.5f : 0.0f;
+
+    out[i] = (unsigned char)(ldr > 255.0f ? 255.0f : ldr);
+  }
+
+  // The alpha channel is linear, so we go back over it.
+  if(channels % 2 == 0) {
+    for(size_t p = 0; p < pixels_count; p++) {
+      float alpha = in[p * channels + channels - 1] * 255.0f + 0.5f;
+      alpha       = alpha < 0.0f ? 0.0f : (alpha > 255.0f ? 255.0f : alpha);
+
+      out[p * channels + channels - 1] = (unsigned char)alpha;
+    }
+  }
+}
+
+/// Loads any image as `float`s, converting LDR images with the given `params`. This is the 
+/// thread-safe version of calling `stbi_ldr_to_hdr_*` and then `stbi_loadf`. Free it with `stbi_image_free`.
+
+static float* image_load_hdr(const char* path, int* width, int* height, int* channels, int desired_channels, ImageToneParams params) {
+  if(stbi_is_hdr(path)) {
+    return stbi_loadf(path, width, height, channels, desired_channels);
+  }
+
+  unsigned char* ldr = stbi_load(path, width, height, channels, desired_channels);
+  if(!ldr) {
+    return nullptr;
+  }
+
+  int out_channels = desired_channels != 0 ? desired_channels : *channels;
+  size_t pixels    = (size_t)*width * *height;
+
+  // Allocated with `STBI_MALLOC`, so `stbi_image_free` works on it just like on stb_image's own buffers.
+  float* hdr = (float*)STBI_MALLOC(pixels * out_channels * sizeof(float));
+  if(hdr) {
+    image_ldr_to_hdr(ldr, hdr, pixels, out_channels, params);
+  }
+
+  stbi_image_free(ldr);
+  return hdr;
+}
+
+/// Loads any image as bytes, converting HDR images with the given `params`. This is the 
+/// thread-safe version of calling `stbi_hdr_to_ldr_*` and then `stbi_load`. Free it with `stbi_image_free`.
+
+static unsigned char* image_load_ldr(const char* path, int* width, int* height, int* channels, int desired_channels, ImageToneParams params) {
+  if(!stbi_is_hdr(path)) {
+    return stbi_load(path, width, height, channels, desired_channels);
+  }
+
+  float* hdr = stbi_loadf(path, width, height, channels, desired_channels);
+  if(!hdr) {
+    return nullptr;
+  }
+
+  int out_channels = desired_channels != 0 ? desired_channels : *channels;
+  size_t pixels    = (size_t)*width * *height;
+
+  unsigned char* ldr = (unsigned char*)STBI_MALLOC(pixels * out_channels);
+  if(ldr) {
+    image_hdr_to_ldr(hdr, ldr, pixels, out_channels, params);
+  }
+
+  stbi_image_free(hdr);
+  return ldr;
+}
+
+/// Besides the final pixels, every decode makes a bunch of short-lived allocations along the way: 
+/// zlib buffers for PNGs, scanline and component buffers for JPGs, and so on. All of them go 
+/// through the global heap by default. 
+///
+/// With the `STBI_MALLOC`, `STBI_REALLOC_SIZED`, and `STBI_FREE` hooks at the top of this file, we can 
+/// send those allocations to a "bump" arena instead: one block of memory per thread that hands out 
+/// pieces by bumping an offset, and that is reset in one go once the load is over. 
+///
+/// The final pixel buffer is the one allocation that has to outlive the load, though. Luckily, we 
+/// know exactly how big it is before loading (thanks to `stbi_info`), so any allocation of exactly 
+/// that size is treated as the final buffer. If the caller gave us a destination (a slice of a 
+/// bigger buffer, or some mapped GPU memory), stb_image decodes straight into it. Otherwise, the 
+/// final buffer goes to the heap like before. If stb_image ends up returning some other buffer (it 
+/// happens with some format conversions), we just copy it over at the end.
+///
+/// If an allocation doesn't fit in the arena, it falls back to the heap and counts as a 
+/// `heap_allocations_count`. Big PNGs inflate the whole image in one buffer, so expect a few of 
+/// those unless the arena is bigger than your largest texture.
+
+#define IMAGE_ARENA_CAPACITY  (16 * 1024 * 1024)
+#define IMAGE_ARENA_ALIGNMENT 16
+
+struct ImageArena {
+  unsigned char* memory; 
+  size_t capacity; 
+  size_t offset; 
+  size_t last_offset; // Where the most recent allocation started
+};
+
+/// Every arena allocation is preceded by a small header that stores its size. stb_image hands 
+/// `realloc` the old size itself, but the header keeps the arena easy to inspect in a debugger, 
+/// and keeps every allocation aligned.
+
+struct ImageArenaHeader {
+  size_t size; 
+  unsigned char padding[IMAGE_ARENA_ALIGNMENT - sizeof(size_t)];
+};
+
+/// What a single load reports back.
+
+struct ImageLoadStats {
+  size_t allocations_count; 
+  size_t reallocations_count; 
+  size_t heap_allocations_count; 
+  size_t bytes_requested; 
+  size_t peak_arena_bytes;
+  bool is_zero_copy; // The final pixels were decoded straight into the destination
+};
+
+/// The state of the load currently running on this thread. When `arena` is `nullptr`, the hooks 
+/// just forward to the regular heap functions.
+
+struct ImageLoadState {
+  ImageArena* arena; 
+  size_t final_size;
+
+  void* destination; 
+  bool is_destination_used;
+
+  ImageLoadStats stats;
+};
+
+static thread_local ImageLoadState image_load_state = {};
+
+static bool image_arena_owns(ImageArena* arena, void* ptr) {
+  return (unsigned char*)ptr >= arena->memory && (unsigned char*)ptr < arena->memory + arena->capacity;
+}
+
+static void* image_arena_malloc(size_t size) {
+  ImageLoadState& state = image_load_state;
+  if(!state.arena) {
+    return malloc(size);
+  }
+
+  state.stats.allocations_count++;
+  state.stats.bytes_requested += size;
+
+  // The final pixel buffer goes to the destination (if there is one) or the heap.
+  if(size == state.final_size) {
+    if(state.destination && !state.is_destination_used) {
+      state.is_destination_used = true;
+      return state.destination;
+    }
+
+    state.stats.heap_allocations_count++;
+    return malloc(size);
+  }
+
+  ImageArena* arena   = state.arena;
+  size_t aligned_size = (size + (IMAGE_ARENA_ALIGNMENT - 1)) & ~(size_t)(IMAGE_ARENA_ALIGNMENT - 1);
+
+  if(arena->offset + sizeof(ImageArenaHeader) + aligned_size > arena->capacity) {
+    state.stats.heap_allocations_count++;
+    return malloc(size);
+  }
+
+  ImageArenaHeader* header = (ImageArenaHeader*)(arena->memory + arena->offset);
+  header->size             = size;
+
+  arena->last_offset = arena->offset;
+  arena->offset     += sizeof(ImageArenaHeader) + aligned_size;
+
+  state.stats.peak_arena_bytes = arena->offset > state.stats.peak_arena_bytes ? arena->offset : state.stats.peak_arena_bytes;
+  return header + 1;
+}
+
+static void image_arena_free(void* ptr) {
+  ImageLoadState& state = image_load_state;
+  if(!ptr) {
+    return;
+  }
+
+  if(state.arena && ptr == state.destination) {
+    state.is_destination_used = false;
+    return;
+  }
+
+  if(!state.arena || !image_arena_owns(state.arena, ptr)) {
+    free(ptr);
+    return;
+  }
+
+  // Only the most recent allocation can actually be given back. Everything else waits for the reset.
+  ImageArenaHeader* header = (ImageArenaHeader*)ptr - 1;
+  if((unsigned char*)header == state.arena->memory + state.arena->last_offset) {
+    state.arena->offset = state.arena->last_offset;
+  }
+}
+
+static void* image_arena_realloc(void* ptr, size_t old_size, size_t new_size) {
+  ImageLoadState& state = image_load_state;
+  if(!state.arena) {
+    return realloc(ptr, new_size);
+  }
+
+  if(!ptr) {
+    return image_arena_malloc(new_size);
+  }
+
+  state.stats.reallocations_count++;
+
+  if(image_arena_owns(state.arena, ptr)) {
+    ImageArena* arena        = state.arena;
+    ImageArenaHeader* header = (ImageArenaHeader*)ptr - 1;
+
+    // If it's the most recent allocation and there's room, we can just grow it in place.
+    size_t aligned_size = (new_size + (IMAGE_ARENA_ALIGNMENT - 1)) & ~(size_t)(IMAGE_ARENA_ALIGNMENT - 1);
+    size_t new_offset   = arena->last_offset + sizeof(ImageArenaHeader) + aligned_size;
+
+    if((unsigned char*)header == arena->memory + arena->last_offset && new_offset <= arena->capacity && new_size != state.final_size) {
+      state.stats.bytes_requested += new_size > old_size ? new_size - old_size : 0;
+
+      arena->offset = new_offset;
+      header->size  = new_size;
+
+      state.stats.peak_arena_bytes = new_offset > state.stats.peak_arena_bytes ? new_offset : state.stats.peak_arena_bytes;
+      return ptr;
+    }
+  }
+  else if(ptr != state.destination) {
+    return realloc(ptr, new_size); // A heap allocation stays a heap allocation
+  }
+
+  void* new_ptr = image_arena_malloc(new_size);
+  if(new_ptr) {
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    image_arena_free(ptr);
+  }
+
+  return new_ptr;
+}
+
+struct ImageArenaOwner {
+  ImageArena arena = {};
+
+  ~ImageArenaOwner() {
+    free(arena.memory);
+  }
+};
+
+/// Returns the arena of the calling thread, creating it the first time it's used on that thread.
+
+static ImageArena* image_arena_get_thread() {
+  static thread_local ImageArenaOwner owner;
+
+  if(!owner.arena.memory) {
+    owner.arena.memory   = (unsigned char*)malloc(IMAGE_ARENA_CAPACITY);
+    owner.arena.capacity = IMAGE_ARENA_CAPACITY;
+  }
+
+  return &owner.arena;
+}
+
+/// Loads an image using the calling thread's arena for every temporary allocation. With `as_float`, 
+/// it works like `stbi_loadf`, otherwise like `stbi_load`. 
+///
+/// If `destination` is given, the pixels end up there, and it must be at least `destination_size` 
+/// bytes (the function fails if the image doesn't fit). The returned pointer is then `destination` 
+/// itself. Otherwise, the pixels are returned in a new buffer you free with `stbi_image_free`. 
+/// Either way, `stats` (if given) gets the allocation counts of this load.
+
+static void* image_load_arena(const char* path, int* width, int* height, int* channels, int desired_channels, bool as_float, 
+                              void* destination, size_t destination_size, ImageLoadStats* stats) {
+  int info_channels;
+  if(stbi_info(path, width, height, &info_channels) != 1) {
+    return nullptr;
+  }
+
+  size_t final_size = (size_t)*width * *height * (desired_channels != 0 ? desired_channels : info_channels) * (as_float ? sizeof(float) : 1);
+  if(destination && final_size > destination_size) {
+    return nullptr;
+  }
+
+  ImageLoadState& state     = image_load_state;
+  state                     = ImageLoadState{};
+  state.arena               = image_arena_get_thread();
+  state.final_size          = final_size;
+  state.destination         = destination;
+
+  void* pixels = as_float ? (void*)stbi_loadf(path, width, height, channels, desired_channels)
+                          : (void*)stbi_load(path, width, height, channels, desired_channels);
+
+  /// Getting the final pixels where they belong. If stb_image returned the destination, there's 
+  /// nothing to do. If not, the pixels are copied over (or out of the arena, which is about to be reset).
+
+  void* result = pixels;
+
+  if(pixels && pixels != destination) {
+    if(destination) {
+      memcpy(destination, pixels, final_size);
+      image_arena_free(pixels);
+      result = destination;
+    }
+    else if(image_arena_owns(state.arena, pixels)) {
+      result = malloc(final_size);
+      memcpy(result, pixels, final_size);
+    }
+  }
+
+  state.stats.is_zero_copy = pixels && pixels == destination;
+  if(stats) {
+    *stats = state.stats;
+  }
+
+  // Resetting the arena for the next load, and going back to the regular heap.
+  state.arena->offset      = 0;
+  state.arena->last_offset = 0;
+  state.arena              = nullptr;
+
+  return result;
+}
+
+/// Loading textures one `stbi_load` at a time only uses one core, and every texture ends up 
+/// in its own allocation. The batch loader below loads a whole list of images on all cores 
+/// into _one_ buffer. 
+///
+/// It works in two passes over the list: 
+///
+///   1. The "info" pass calls `stbi_info` (and `stbi_is_hdr`) on every file. That only reads the 
+///      headers, so it's cheap, and it tells us exactly how many bytes every image will take. 
+///      With that, we make the one big allocation and reserve a slice of it for every image.
+///   2. The "load" pass decodes every image on the thread pool, and each thread decodes its image 
+///      straight into the slice reserved for it (see `image_load_arena` above). Since the slices 
+///      never overlap, the threads never have to wait on each other.
+///
+/// HDR images are loaded with `stbi_loadf` (so their slice holds `float`s), and everything else with 
+/// `stbi_load`. Every slice starts at a 16 byte boundary so it can be handed to SIMD code directly.
+
+struct ImageBatchEntry {
+  int width; 
+  int height; 
+  int channels; // The channels the image is loaded with (the `desired_channels`, if not 0)
+  bool is_hdr;
+
+  size_t data_offset; // Where the pixels start in `ImageBatch.data`, in bytes
+  size_t data_size;
+  bool is_loaded;
+};
+
+struct ImageBatch {
+  unsigned char* data; // Every image, one after the other. Free it with `free`.
+  size_t data_size;
+
+  std::vector<ImageBatchEntry> entries; // One per path, in the same order
+};
+
+/// Runs `task(index)` for every index on `threads_count` threads. The threads just grab the next 
+/// index from a shared counter, so a thread that finishes early simply takes more images.
+
+static void image_batch_run(unsigned int threads_count, size_t tasks_count, const std::function<void(size_t)>& task) {
+  std::atomic<size_t> next_task(0);
+
+  auto worker = [&]() {
+    for(size_t index = next_task.fetch_add(1); index < tasks_count; index = next_task.fetch_add(1)) {
+      task(index);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int i = 1; i < threads_count; i++) {
+    threads.emplace_back(worker);
+  }
+
+  worker(); // The calling thread helps out as well
+
+  for(std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Loads every image in `paths` into `batch`. The `desired_channels` works the same way as the 
+/// last parameter of `stbi_load`. Images that fail to load have `is_loaded` set to `false`, but 
+/// don't stop the rest of the batch. Returns `false` (with nothing left to free in `batch`) only 
+/// if the one big allocation fails.
+
+static bool image_batch_load(ImageBatch* batch, const char* const* paths, size_t paths_count, int desired_channels, unsigned int threads_count) {
+  batch->entries.assign(paths_count, ImageBatchEntry{});
+
+  /// The info pass.
+
+  image_batch_run(threads_count, paths_count, [&](size_t index) {
+    ImageBatchEntry& entry = batch->entries[index];
+
+    int channels_in_file = 0;
+    if(stbi_info(paths[index], &entry.width, &entry.height, &channels_in_file) != 1) {
+      entry.width = entry.height = 0;
+      return;
+    }
+
+    entry.channels  = desired_channels != 0 ? desired_channels : channels_in_file;
+    entry.is_hdr    = stbi_is_hdr(paths[index]) == 1;
+    entry.data_size = (size_t)entry.width * entry.height * entry.channels * (entry.is_hdr ? sizeof(float) : 1);
+  });
+
+  /// Reserving a slice for every image, and making the one big allocation.
+
+  batch->data_size = 0;
+  for(ImageBatchEntry& entry : batch->entries) {
+    entry.data_offset = batch->data_size;
+    batch->data_size += (entry.data_size + 15) & ~(size_t)15;
+  }
+
+  batch->data = (unsigned char*)malloc(batch->data_size);
+  if(!batch->data && batch->data_size > 0) {
+    batch->entries.clear();
+    batch->data_size = 0;
+    return false;
+  }
+
+  /// The load pass. Each image is decoded straight into its slice by `image_load_arena`, with 
+  /// every temporary allocation coming from the worker thread's own arena.
+
+  image_batch_run(threads_count, paths_count, [&](size_t index) {
+    ImageBatchEntry& entry = batch->entries[index];
+    if(entry.data_size == 0) {
+      return;
+    }
+
+    int width, height, channels;
+    void* pixels = image_load_arena(paths[index], &width, &height, &channels, entry.channels, entry.is_hdr, 
+                                    batch->data + entry.data_offset, entry.data_size, nullptr);
+
+    // The file could have changed since the info pass, so make sure it's still the same size.
+    entry.is_loaded = pixels && width == entry.width && height == entry.height;
+  });
+
+  return true;
+}
+
+/// Once an image is loaded, the next thing a renderer usually wants is its mipmap chain: the 
+/// image at half the size, then a quarter, and so on down to 1x1. The functions below build the 
+/// whole chain from the output of `stbi_load(..., 4)` or `stbi_loadf(..., 4)`.
+///
+/// A few things make this much faster than a per-pixel scalar loop:
+///
+///   - Every RGBA pixel is 4 `float`s, which is exactly one SSE register. So every filter tap is 
+///     one multiply-add on the whole pixel.
+///   - The levels are computed from each other (level 2 from level 1, and so on), and each level 
+///     is split into bands of rows ("tiles") spread over the `image_batch_run` thread pool from above. 
+///     Small levels stay on the calling thread, since they're done before a thread would even start.
+///   - Every level goes into one contiguous allocation, 16 byte aligned, like the batch loader.
+///
+/// 8 bit images are assumed to be sRGB, which is what almost every PNG and JPG is. Averaging sRGB 
+/// values directly makes the smaller levels too dark, so the color channels are converted to 
+/// linear (with a 256 entry table), filtered there, and converted back (with a bigger table, 
+/// indexed by the linear value). Alpha is already linear and is filtered as-is. The lower levels 
+/// are computed from a `float` copy of the previous level rather than its 8 bit version, so the 
+/// rounding errors don't pile up level after level. `float` images are already linear, so they're 
+/// filtered directly.
+///
+/// There are two filters:
+///
+///   - `IMAGE_MIP_BOX` averages each 2x2 block. It's the fastest one, and what most engines use.
+///   - `IMAGE_MIP_KAISER` is a 6x6 Kaiser-windowed sinc. It keeps the smaller levels sharper, 
+///     at roughly 3 times the cost.
+///
+/// Odd sizes are rounded down (a 5x3 image gives a 2x1 level), and the samples that fall off the 
+/// edge are clamped to the edge.
+
+#define IMAGE_MIP_MAX_LEVELS     16
+#define IMAGE_MIP_TILE_ROWS      32
+#define IMAGE_MIP_PARALLEL_MIN   (256 * 256) // Levels with fewer pixels than this stay on one thread
+#define IMAGE_SRGB_TABLE_SIZE    16384
+
+enum ImageMipFilter {
+  IMAGE_MIP_BOX, 
+  IMAGE_MIP_KAISER,
+};
+
+struct ImageMipLevel {
+  int width; 
+  int height; 
+  size_t data_offset; // Where the pixels start in `ImageMipChain.data`, in bytes
+};
+
+struct ImageMipChain {
+  unsigned char* data; // Every level, one after the other. Free it with `free`.
+  size_t data_size;
+  bool is_float;       // `float` RGBA when `true`, 8 bit RGBA otherwise
+
+  int levels_count;
+  ImageMipLevel levels[IMAGE_MIP_MAX_LEVELS];
+};
+
+/// One RGBA pixel, in linear `float`s. An SSE register when we have SSE2, and a plain array otherwise.
+
+#if defined(IMAGE_HAS_SSE2)
+
+struct ImageMipPixel {
+  __m128 v;
+};
+
+static inline ImageMipPixel image_mip_zero() {
+  return ImageMipPixel{_mm_setzero_ps()};
+}
+
+static inline ImageMipPixel image_mip_load(const float* in) {
+  return ImageMipPixel{_mm_loadu_ps(in)};
+}
+
+static inline void image_mip_store(float* out, ImageMipPixel p) {
+  _mm_storeu_ps(out, p.v);
+}
+
+static inline ImageMipPixel image_mip_add(ImageMipPixel a, ImageMipPixel b) {
+  return ImageMipPixel{_mm_add_ps(a.v, b.v)};
+}
+
+static inline ImageMipPixel image_mip_scale(ImageMipPixel p, float weight) {
+  return ImageMipPixel{_mm_mul_ps(p.v, _mm_set1_ps(weight))};
+}
+
+static inline ImageMipPixel image_mip_madd(ImageMipPixel acc, ImageMipPixel p, float weight) {
+  return ImageMipPixel{_mm_add_ps(acc.v, _mm_mul_ps(p.v, _mm_set1_ps(weight)))};
+}
+
+#else
+
+struct ImageMipPixel {
+  float v[4];
+};
+
+static inline ImageMipPixel image_mip_zero() {
+  return ImageMipPixel{};
+}
+
+static inline ImageMipPixel image_mip_load(const float* in) {
+  ImageMipPixel p;
+  memcpy(p.v, in, sizeof(p.v));
+  return p;
+}
+
+static inline void image_mip_store(float* out, ImageMipPixel p) {
+  memcpy(out, p.v, sizeof(p.v));
+}
+
+static inline ImageMipPixel image_mip_madd(ImageMipPixel acc, ImageMipPixel p, float weight) {
+  for(int ch = 0; ch < 4; ch++) {
+    acc.v[ch] += p.v[ch] * weight;
+  }
+  return acc;
+}
+
+static inline ImageMipPixel image_mip_add(ImageMipPixel a, ImageMipPixel b) {
+  return image_mip_madd(a, b, 1.0f);
+}
+
+static inline ImageMipPixel image_mip_scale(ImageMipPixel p, float weight) {
+  return image_mip_madd(image_mip_zero(), p, weight);
+}
+
+#endif // IMAGE_HAS_SSE2
+
+/// The sRGB <-> linear tables. Built once, the first time they're needed (C++11 makes the 
+/// initialization of a function `static` thread-safe).
+
+struct ImageSrgbTables {
+  float to_linear[256];
+  unsigned char to_srgb[IMAGE_SRGB_TABLE_SIZE]; // Indexed by `linear * (IMAGE_SRGB_TABLE_SIZE - 1)`
+};
+
+static const ImageSrgbTables& image_srgb_tables() {
+  static const ImageSrgbTables tables = []() {
+    ImageSrgbTables t;
+
+    for(int i = 0; i < 256; i++) {
+      float srgb     = i / 255.0f;
+      t.to_linear[i] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for(int i = 0; i < IMAGE_SRGB_TABLE_SIZE; i++) {
+      float linear = i / (float)(IMAGE_SRGB_TABLE_SIZE - 1);
+      float srgb   = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+      t.to_srgb[i] = (unsigned char)(srgb * 255.0f + 0.5f);
+    }
+
+    return t;
+  }();
+
+  return tables;
+}
+
+/// Where a level reads its pixels from: the 8 bit sRGB base image, or `float` linear pixels 
+/// (a `float` image, or the `float` copy of the previous level).
+
+struct ImageMipSource {
+  const unsigned char* srgb; 
+  const float* linear; 
+  int width; 
+  int height;
+};
+
+/// Where a level writes its pixels to. `linear` is optional, and receives the `float` copy used to 
+/// compute the next level of an 8 bit chain.
+
+struct ImageMipTarget {
+  unsigned char* srgb; 
+  float* linear; 
+  int width; 
+  int height;
+};
+
+static void image_mip_load_row(const ImageMipSource& source, int y, ImageMipPixel* out) {
+  y = y < 0 ? 0 : (y >= source.height ? source.height - 1 : y);
+
+  if(source.linear) {
+    const float* row = source.linear + (size_t)y * source.width * 4;
+    for(int x = 0; x < source.width; x++) {
+      out[x] = image_mip_load(row + x * 4);
+    }
+    return;
+  }
+
+  const float* to_linear   = image_srgb_tables().to_linear;
+  const unsigned char* row = source.srgb + (size_t)y * source.width * 4;
+
+  for(int x = 0; x < source.width; x++) {
+    float pixel[4] = {to_linear[row[x * 4 + 0]], to_linear[row[x * 4 + 1]], to_linear[row[x * 4 + 2]], row[x * 4 + 3] / 255.0f};
+    out[x] = image_mip_load(pixel);
+  }
+}
+
+static void image_mip_store_row(const ImageMipTarget& target, int y, const ImageMipPixel* in) {
+  if(target.linear) {
+    float* row = target.linear + (size_t)y * target.width * 4;
+    for(int x = 0; x < target.width; x++) {
+      image_mip_store(row + x * 4, in[x]);
+    }
+  }
+
+  if(!target.srgb) {
+    return;
+  }
+
+  const unsigned char* to_srgb = image_srgb_tables().to_srgb;
+  unsigned char* row           = target.srgb + (size_t)y * target.width * 4;
+
+  for(int x = 0; x < target.width; x++) {
+    float pixel[4];
+    image_mip_store(pixel, in[x]);
+
+    for(int ch = 0; ch < 4; ch++) {
+      float value = pixel[ch] < 0.0f ? 0.0f : (pixel[ch] > 1.0f ? 1.0f : pixel[ch]); // Kaiser can over/undershoot a little
+      row[x * 4 + ch] = ch == 3 ? (unsigned char)(value * 255.0f + 0.5f) : to_srgb[(int)(value * (IMAGE_SRGB_TABLE_SIZE - 1) + 0.5f)];
+    }
+  }
+}
+
+/// The Kaiser weights. Downsampling by exactly 2 means every destination pixel sees its 6 source 
+/// pixels at the same distances (0.5, 1.5, and 2.5 source pixels away on each side), so the 6 
+/// weights are the same everywhere and only need computing once.
+
+#define IMAGE_MIP_KAISER_TAPS 6
+
+static const float* image_mip_kaiser_weights() {
+  static const std::vector<float> weights = []() {
+    const double pi     = 3.14159265358979323846;
+    const double alpha  = 4.0;
+    const double radius = 1.5; // In destination pixels, so 3 source pixels on each side
+
+    // The zeroth order modified Bessel function, which the Kaiser window is built from.
+    auto bessel_i0 = [](double x) {
+      double sum = 1.0, term = 1.0;
+      for(int k = 1; k < 20; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum  += term;
+      }
+      return sum;
+    };
+
+    std::vector<float> w(IMAGE_MIP_KAISER_TAPS);
+    double total = 0.0;
+
+    for(int i = 0; i < IMAGE_MIP_KAISER_TAPS; i++) {
+      double distance = (i - IMAGE_MIP_KAISER_TAPS / 2 + 0.5) / 2.0; // In destination pixels
+      double sinc     = sin(pi * distance) / (pi * distance);
+      double ratio    = distance / radius;
+      double window   = bessel_i0(alpha * sqrt(1.0 - ratio * ratio)) / bessel_i0(alpha);
+
+      w[i]   = (float)(sinc * window);
+      total += w[i];
+    }
+
+    for(float& weight : w) {
+      weight = (float)(weight / total);
+    }
+
+    return w;
+  }();
+
+  return weights.data();
+}
+
+/// Computes the destination rows `[first_row, last_row)` of one level. `rows`, `row`, and `out` 
+/// are the calling thread's scratch space, so they're only allocated once per thread.
+
+static void image_mip_filter_rows(const ImageMipSource& source, const ImageMipTarget& target, ImageMipFilter filter, int first_row, int last_row) {
+  static thread_local std::vector<ImageMipPixel> rows;
+  static thread_local std::vector<ImageMipPixel> row;
+  static thread_local std::vector<ImageMipPixel> out;
+
+  int taps = filter == IMAGE_MIP_BOX ? 2 : IMAGE_MIP_KAISER_TAPS;
+
+  rows.resize((size_t)source.width * taps);
+  row.resize(source.width);
+  out.resize(target.width);
+
+  for(int y = first_row; y < last_row; y++) {
+    /// The vertical pass: blending the source rows under this destination row into `row`.
+
+    for(int t = 0; t < taps; t++) {
+      image_mip_load_row(source, y * 2 - taps / 2 + 1 + t, rows.data() + (size_t)t * source.width);
+    }
+
+    if(filter == IMAGE_MIP_BOX) {
+      for(int x = 0; x < source.width; x++) {
+        row[x] = image_mip_add(rows[x], rows[source.width + x]);
+      }
+    }
+    else {
+      const float* weights = image_mip_kaiser_weights();
+
+      for(int x = 0; x < source.width; x++) {
+        ImageMipPixel sum = image_mip_zero();
+        for(int t = 0; t < taps; t++) {
+          sum = image_mip_madd(sum, rows[(size_t)t * source.width + x], weights[t]);
+        }
+        row[x] = sum;
+      }
+    }
+
+    /// The horizontal pass, from `row` into the destination row.
+
+    for(int x = 0; x < target.width; x++) {
+      if(filter == IMAGE_MIP_BOX) {
+        int right = x * 2 + 1 < source.width ? x * 2 + 1 : source.width - 1;
+        out[x]    = image_mip_scale(image_mip_add(row[x * 2], row[right]), 0.25f);
+        continue;
+      }
+
+      const float* weights = image_mip_kaiser_weights();
+      ImageMipPixel sum    = image_mip_zero();
+
+      for(int t = 0; t < taps; t++) {
+        int sx = x * 2 - taps / 2 + 1 + t;
+        sx     = sx < 0 ? 0 : (sx >= source.width ? source.width - 1 : sx);
+        sum    = image_mip_madd(sum, row[sx], weights[t]);
+      }
+
+      out[x] = sum;
+    }
+
+    image_mip_store_row(target, y, out.data());
+  }
+}
+
+/// Builds the full mipmap chain of a 4 channel image. Pass the pixels of `stbi_load(..., 4)` as 
+/// `srgb_pixels`, or the pixels of `stbi_loadf(..., 4)` as `float_pixels` (and `nullptr` for the other). 
+/// Level 0 is a copy of the image itself. Returns `false` if the allocation fails.
+
+static bool image_mip_build(ImageMipChain* chain, const unsigned char* srgb_pixels, const float* float_pixels, int width, int height, 
+                            ImageMipFilter filter, unsigned int threads_count) {
+  chain->is_float     = float_pixels != nullptr;
+  chain->levels_count = 0;
+  chain->data_size    = 0;
+
+  size_t pixel_size = chain->is_float ? 4 * sizeof(float) : 4;
+
+  /// Working out the size of every level, and where it goes in the allocation.
+
+  for(int w = width, h = height; chain->levels_count < IMAGE_MIP_MAX_LEVELS; w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1) {
+    chain->levels[chain->levels_count++] = ImageMipLevel{w, h, chain->data_size};
+    chain->data_size += ((size_t)w * h * pixel_size + 15) & ~(size_t)15;
+
+    if(w == 1 && h == 1) {
+      break;
+    }
+  }
+
+  chain->data = (unsigned char*)malloc(chain->data_size);
+  if(!chain->data) {
+    return false;
+  }
+
+  memcpy(chain->data, chain->is_float ? (const void*)float_pixels : (const void*)srgb_pixels, (size_t)width * height * pixel_size);
+
+  /// The `float` copies of the levels, for 8 bit chains. Each level reads the copy of the level 
+  /// before it, so odd levels write to one buffer and even levels to the other. Level 1 is the 
+  /// biggest odd level, and level 2 the biggest even one.
+
+  std::vector<float> linear[2];
+  if(!chain->is_float && chain->levels_count > 2) {
+    linear[1].resize((size_t)chain->levels[1].width * chain->levels[1].height * 4);
+    linear[0].resize((size_t)chain->levels[2].width * chain->levels[2].height * 4);
+  }
+
+  for(int i = 1; i < chain->levels_count; i++) {
+    const ImageMipLevel& previous = chain->levels[i - 1];
+    const ImageMipLevel& level    = chain->levels[i];
+
+    ImageMipSource source = {nullptr, nullptr, previous.width, previous.height};
+    ImageMipTarget target = {nullptr, nullptr, level.width, level.height};
+
+    if(chain->is_float) {
+      source.linear = (const float*)(chain->data + previous.data_offset);
+      target.linear = (float*)(chain->data + level.data_offset);
+    }
+    else {
+      source.srgb   = i == 1 ? chain->data : nullptr; // Level 1 reads the 8 bit base image itself
+      source.linear = i == 1 ? nullptr : linear[(i - 1) % 2].data();
+      target.srgb   = chain->data + level.data_offset;
+      target.linear = i + 1 < chain->levels_count ? linear[i % 2].data() : nullptr; // The last level has no one to feed
+    }
+
+    int tiles_count = (level.height + IMAGE_MIP_TILE_ROWS - 1) / IMAGE_MIP_TILE_ROWS;
+    bool is_big     = (size_t)level.width * level.height >= IMAGE_MIP_PARALLEL_MIN;
+
+    image_batch_run(is_big ? threads_count : 1, tiles_count, [&](size_t tile) {
+      int first_row = (int)tile * IMAGE_MIP_TILE_ROWS;
+      int last_row  = first_row + IMAGE_MIP_TILE_ROWS < level.height ? first_row + IMAGE_MIP_TILE_ROWS : level.height;
+
+      image_mip_filter_rows(source, target, filter, first_row, last_row);
+    });
+  }
+
+  return true;
+}
 
 int main() {
   /// This function, as the name implies, will load in the pixels of an image 
@@ -94,9 +1418,391 @@ int main() {
   /// call `free(pixels)` ourselves, since STB does do some additional cleanup.
   ///
   /// However, if you do wish to insert your own allocation and de-allocation functionality, 
-  /// you can do so by `#define` the STBI_MALLOC(size), STBI_REALLOC(ptr, new_size), and STBI_FREE(ptr) 
+  /// you can do so by `#define` the STBI_MALLOC(size), STBI_REALLOC(ptr, new_size) (or STBI_REALLOC_SIZED), and STBI_FREE(ptr) 
   /// before the `#include stb_image.h` line.
 
   stbi_image_free(pixels);
   stbi_image_free(hdr_pixels);
+
+  /// Now, let's try the batch loader from above. To have something to load, we first generate 
+  /// a small corpus of PNG, JPG, and HDR images using stb_image_write (stb_image's sibling, which 
+  /// is only used here to have files to load). Then we load the whole corpus one `stbi_load` at a 
+  /// time, and with the batch loader using 1 up to as many threads as the machine has.
+
+  const int corpus_size = 48;
+  const int image_size  = 1024;
+
+  std::vector<unsigned char> ldr_pixels((size_t)image_size * image_size * 4);
+  std::vector<float> hdr_pixels_out((size_t)image_size * image_size * 3);
+
+  for(int y = 0; y < image_size; y++) {
+    for(int x = 0; x < image_size; x++) {
+      size_t i = (size_t)y * image_size + x;
+
+      ldr_pixels[i * 4 + 0] = (unsigned char)(x ^ y);
+      ldr_pixels[i * 4 + 1] = (unsigned char)(x * 3);
+      ldr_pixels[i * 4 + 2] = (unsigned char)(y * 5);
+      ldr_pixels[i * 4 + 3] = 255;
+
+      hdr_pixels_out[i * 3 + 0] = x / 64.0f;
+      hdr_pixels_out[i * 3 + 1] = y / 64.0f;
+      hdr_pixels_out[i * 3 + 2] = 1.0f;
+    }
+  }
+
+  std::vector<std::string> corpus_paths;
+  for(int i = 0; i < corpus_size; i++) {
+    char path[256];
+
+    switch(i % 3) {
+      case 0:
+        snprintf(path, sizeof(path), "corpus_%02i.png", i);
+        stbi_write_png(path, image_size, image_size, 4, ldr_pixels.data(), image_size * 4);
+        break;
+      case 1:
+        snprintf(path, sizeof(path), "corpus_%02i.jpg", i);
+        stbi_write_jpg(path, image_size, image_size, 4, ldr_pixels.data(), 90);
+        break;
+      case 2:
+        snprintf(path, sizeof(path), "corpus_%02i.hdr", i);
+        stbi_write_hdr(path, image_size, image_size, 3, hdr_pixels_out.data());
+        break;
+    }
+
+    corpus_paths.push_back(path);
+  }
+
+  std::vector<const char*> corpus;
+  for(const std::string& path : corpus_paths) {
+    corpus.push_back(path.c_str());
+  }
+
+  auto serial_start = std::chrono::steady_clock::now();
+
+  for(const char* path : corpus) {
+    int w, h, c;
+    void* image = stbi_is_hdr(path) ? (void*)stbi_loadf(path, &w, &h, &c, 4) : (void*)stbi_load(path, &w, &h, &c, 4);
+    stbi_image_free(image);
+  }
+
+  double serial_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - serial_start).count();
+  printf("IMAGES (serial stbi_load): %.2f ms\n", serial_ms);
+
+  unsigned int max_threads = std::thread::hardware_concurrency();
+  max_threads              = max_threads == 0 ? 1 : max_threads;
+
+  for(unsigned int threads_count = 1; threads_count <= max_threads; threads_count++) {
+    ImageBatch batch;
+
+    auto start = std::chrono::steady_clock::now();
+    if(!image_batch_load(&batch, corpus.data(), corpus.size(), 4, threads_count)) {
+      printf("ERROR: Could not allocate the batch's pixels!\n");
+      break; // Still removing the corpus below
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("IMAGES (%2u threads): %.2f ms, %.2fx speedup, %zu bytes in one buffer\n", 
+           threads_count, elapsed_ms, serial_ms / elapsed_ms, batch.data_size);
+
+    // Each image lives at `batch.data + entry.data_offset`.
+    free(batch.data);
+  }
+
+  for(const char* path : corpus) {
+    remove(path);
+  }
+
+  /// Finally, let's compare the three ways of feeding stb_image: stdio (`stbi_load`), a memory-mapped 
+  /// file (`stbi_load_from_memory`), and a packed archive read through `stbi_io_callbacks`. 
+  ///
+  /// We generate one big BMP and one big PNG. The BMP is uncompressed, so loading it is almost 
+  /// all I/O, while the PNG spends most of its time inflating. Then we pack both of them into 
+  /// a simple archive (just the two files one after the other), and load each image 20 times 
+  /// with each method.
+  ///
+  /// The numbers are in megabytes of _file_ data per second. Run it twice, so the files 
+  /// are in the OS cache both times.
+
+  const int big_size = 4096;
+  std::vector<unsigned char> big_pixels((size_t)big_size * big_size * 4);
+
+  for(size_t i = 0; i < big_pixels.size(); i++) {
+    big_pixels[i] = (unsigned char)((i * 2654435761u) >> 24); // Some noise, so the PNG doesn't compress to nothing
+  }
+
+  const char* io_paths[] = {"io_big.bmp", "io_big.png"};
+  stbi_write_bmp(io_paths[0], big_size, big_size, 4, big_pixels.data());
+  stbi_write_png(io_paths[1], big_size, big_size, 4, big_pixels.data(), big_size * 4);
+
+  // Packing the archive and remembering where each entry went.
+  size_t entry_offsets[2], entry_sizes[2];
+  FILE* archive = fopen("io_big.pak", "wb");
+
+  for(int i = 0; i < 2; i++) {
+    MappedFile source;
+    map_file(io_paths[i], &source);
+
+    entry_offsets[i] = (size_t)ftell(archive);
+    entry_sizes[i]   = source.size;
+    fwrite(source.data, 1, source.size, archive);
+
+    unmap_file(&source);
+  }
+
+  fclose(archive);
+
+  int archive_fd                     = open("io_big.pak", O_RDONLY);
+  ArchiveEntryReader* archive_reader = new ArchiveEntryReader;
+
+  const int io_iterations = 20;
+
+  for(int i = 0; i < 2; i++) {
+    double file_megabytes = entry_sizes[i] * io_iterations / (1024.0 * 1024.0);
+    int w, h, c;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int j = 0; j < io_iterations; j++) {
+      stbi_image_free(stbi_load(io_paths[i], &w, &h, &c, 4));
+    }
+    double stdio_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int j = 0; j < io_iterations; j++) {
+      MappedFile mapped;
+      map_file(io_paths[i], &mapped);
+
+      stbi_image_free(stbi_load_from_memory(mapped.data, (int)mapped.size, &w, &h, &c, 4));
+      unmap_file(&mapped);
+    }
+    double mmap_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int j = 0; j < io_iterations; j++) {
+      archive_entry_reader_init(archive_reader, archive_fd, entry_offsets[i], entry_sizes[i]);
+      stbi_image_free(stbi_load_from_callbacks(&ARCHIVE_ENTRY_CALLBACKS, archive_reader, &w, &h, &c, 4));
+    }
+    double callback_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("IO (%s): stdio = %.1f MB/s, mmap = %.1f MB/s, archive callbacks = %.1f MB/s\n", 
+           io_paths[i], file_megabytes / stdio_seconds, file_megabytes / mmap_seconds, file_megabytes / callback_seconds);
+  }
+
+  delete archive_reader;
+  close(archive_fd);
+
+  remove(io_paths[0]);
+  remove(io_paths[1]);
+  remove("io_big.pak");
+
+  /// Now, the decoded-image cache from above. We load a few generated images through the cache 
+  /// twice. The first ("cold") round misses and fills the cache, and the second ("warm") round 
+  /// maps the cached pixels instead of decoding. Delete the `image_cache` directory to see the 
+  /// cold numbers again, since the cache sticks around between runs (that's the whole point).
+
+  const char* cache_paths[] = {"cache_a.png", "cache_b.jpg", "cache_c.png"};
+  stbi_write_png(cache_paths[0], big_size, big_size, 4, big_pixels.data(), big_size * 4);
+  stbi_write_jpg(cache_paths[1], big_size, big_size, 4, big_pixels.data(), 90);
+  stbi_write_png(cache_paths[2], big_size / 2, big_size / 2, 4, big_pixels.data(), big_size / 2 * 4);
+
+  ImageCache image_cache;
+  image_cache_init(&image_cache, "image_cache");
+
+  for(int round = 0; round < 2; round++) {
+    auto start = std::chrono::steady_clock::now();
+
+    for(const char* path : cache_paths) {
+      CachedImage image;
+      if(!image_cache_load(&image_cache, path, 4, false, &image)) {
+        printf("Failed to load '%s'. REASON: %s\n", path, stbi_failure_reason());
+        continue;
+      }
+
+      // ... Upload `image.pixels` to the GPU here ...
+
+      image_cache_release(&image);
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("CACHE (%s): %.2f ms, %i hits, %i misses\n", round == 0 ? "cold" : "warm", elapsed_ms, image_cache.hits.load(), image_cache.misses.load());
+  }
+
+  for(const char* path : cache_paths) {
+    remove(path);
+  }
+
+  /// Now, the per-call conversions from above. First, two threads load the same HDR image as LDR 
+  /// at the same time, each with its own settings. With the global `stbi_hdr_to_ldr_*` functions, 
+  /// that would be a race. At the same time, two more threads load images as HDR: the HDR image 
+  /// comes back as-is, and an LDR image is converted with its own settings.
+
+  stbi_write_hdr("tone.hdr", image_size, image_size, 3, hdr_pixels_out.data());
+  stbi_write_png("tone.png", image_size, image_size, 4, ldr_pixels.data(), image_size * 4);
+
+  std::thread bright_loader([]() {
+    int w, h, c;
+    stbi_image_free(image_load_ldr("tone.hdr", &w, &h, &c, 4, ImageToneParams{2.2f, 0.5f}));
+  });
+
+  std::thread dark_loader([]() {
+    int w, h, c;
+    stbi_image_free(image_load_ldr("tone.hdr", &w, &h, &c, 4, ImageToneParams{1.8f, 4.0f}));
+  });
+
+  std::thread hdr_loader([]() {
+    int w, h, c;
+    stbi_image_free(image_load_hdr("tone.hdr", &w, &h, &c, 4, ImageToneParams{2.2f, 1.0f}));
+  });
+
+  std::thread linear_loader([]() {
+    int w, h, c;
+    stbi_image_free(image_load_hdr("tone.png", &w, &h, &c, 4, ImageToneParams{1.0f, 2.0f}));
+  });
+
+  bright_loader.join();
+  dark_loader.join();
+  hdr_loader.join();
+  linear_loader.join();
+
+  remove("tone.hdr");
+  remove("tone.png");
+
+  /// Then, we time the conversions themselves against a plain scalar `powf` loop (which is what 
+  /// stb_image does internally), over the same 4 channel, 1024x1024 image.
+
+  const size_t tone_pixels = (size_t)image_size * image_size;
+  std::vector<float> tone_hdr(tone_pixels * 4);
+  std::vector<unsigned char> tone_ldr(tone_pixels * 4);
+
+  for(size_t i = 0; i < tone_hdr.size(); i++) {
+    tone_hdr[i] = (i % 97) / 24.0f;
+  }
+
+  ImageToneParams tone_params = {2.2f, 1.0f};
+
+  auto tone_start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < tone_hdr.size(); i++) {
+    float ldr   = powf(tone_hdr[i], 1.0f / tone_params.gamma) * 255.0f + 0.5f;
+    tone_ldr[i] = (unsigned char)(ldr > 255.0f ? 255.0f : ldr);
+  }
+  double scalar_h2l_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tone_start).count();
+
+  tone_start = std::chrono::steady_clock::now();
+  image_hdr_to_ldr(tone_hdr.data(), tone_ldr.data(), tone_pixels, 4, tone_params);
+  double fast_h2l_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tone_start).count();
+
+  tone_start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < tone_ldr.size(); i++) {
+    tone_hdr[i] = powf(tone_ldr[i] / 255.0f, tone_params.gamma) * tone_params.scale;
+  }
+  double scalar_l2h_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tone_start).count();
+
+  tone_start = std::chrono::steady_clock::now();
+  image_ldr_to_hdr(tone_ldr.data(), tone_hdr.data(), tone_pixels, 4, tone_params);
+  double fast_l2h_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tone_start).count();
+
+  printf("TONE (HDR -> LDR): scalar = %.2f ms, per-call = %.2f ms (%.1fx)\n", scalar_h2l_ms, fast_h2l_ms, scalar_h2l_ms / fast_h2l_ms);
+  printf("TONE (LDR -> HDR): scalar = %.2f ms, per-call = %.2f ms (%.1fx)\n", scalar_l2h_ms, fast_l2h_ms, scalar_l2h_ms / fast_l2h_ms);
+
+  /// Then, the arena-backed loads from above. We load the same PNG three times: once into a 
+  /// new buffer, and twice into a destination we own. Notice how the second and third loads reuse the 
+  /// same arena and the same destination, and how few allocations actually reach the heap.
+
+  stbi_write_png("arena.png", image_size, image_size, 4, ldr_pixels.data(), image_size * 4);
+
+  std::vector<unsigned char> arena_destination((size_t)image_size * image_size * 4);
+
+  for(int i = 0; i < 3; i++) {
+    bool use_destination = i > 0;
+    ImageLoadStats stats;
+    int w, h, c;
+
+    void* pixels = image_load_arena("arena.png", &w, &h, &c, 4, false, 
+                                    use_destination ? arena_destination.data() : nullptr, arena_destination.size(), &stats);
+    if(!pixels) {
+      printf("Failed to load image. REASON: %s\n", stbi_failure_reason());
+      continue;
+    }
+
+    printf("ARENA LOAD (%s): %zu allocations, %zu reallocations, %zu on the heap, %zu bytes requested, %zu peak arena bytes, %s\n", 
+           use_destination ? "destination" : "new buffer", stats.allocations_count, stats.reallocations_count, stats.heap_allocations_count, 
+           stats.bytes_requested, stats.peak_arena_bytes, stats.is_zero_copy ? "zero-copy" : "copied");
+
+    if(!use_destination) {
+      stbi_image_free(pixels);
+    }
+  }
+
+  remove("arena.png");
+
+  /// And, finally, the mipmap chains. We build the chain of the big noise image from before with a 
+  /// plain scalar loop (a 2x2 box that converts every sRGB value with `powf`, which is what a lot of 
+  /// code out there does), and then with `image_mip_build` using each filter, on 1 thread and on 
+  /// all of them. The `float` run uses the same pixels, converted to linear `float`s first.
+  ///
+  /// The numbers are in megapixels of the _base_ image per second.
+
+  const double mip_megapixels = (double)big_size * big_size / 1e6;
+
+  auto mip_start = std::chrono::steady_clock::now();
+  {
+    std::vector<unsigned char> previous(big_pixels), next;
+
+    for(int w = big_size, h = big_size; w > 1 || h > 1; ) {
+      int nw = w > 1 ? w / 2 : 1;
+      int nh = h > 1 ? h / 2 : 1;
+      next.resize((size_t)nw * nh * 4);
+
+      for(int y = 0; y < nh; y++) {
+        for(int x = 0; x < nw; x++) {
+          for(int ch = 0; ch < 4; ch++) {
+            float sum = 0.0f;
+
+            for(int dy = 0; dy < 2; dy++) {
+              for(int dx = 0; dx < 2; dx++) {
+                int sx = x * 2 + dx < w ? x * 2 + dx : w - 1;
+                int sy = y * 2 + dy < h ? y * 2 + dy : h - 1;
+                float v = previous[((size_t)sy * w + sx) * 4 + ch] / 255.0f;
+                sum    += ch == 3 ? v : (v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f));
+              }
+            }
+
+            float v  = sum / 4.0f;
+            v        = ch == 3 ? v : (v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f);
+            next[((size_t)y * nw + x) * 4 + ch] = (unsigned char)(v * 255.0f + 0.5f);
+          }
+        }
+      }
+
+      previous.swap(next);
+      w = nw;
+      h = nh;
+    }
+  }
+  double scalar_mip_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mip_start).count();
+  printf("MIPMAPS (scalar box): %.1f MP/s\n", mip_megapixels / scalar_mip_seconds);
+
+  std::vector<float> big_linear(big_pixels.size());
+  for(size_t i = 0; i < big_pixels.size(); i++) {
+    big_linear[i] = image_srgb_tables().to_linear[big_pixels[i]];
+  }
+
+  const char* filter_names[] = {"box", "kaiser"};
+
+  for(int as_float = 0; as_float < 2; as_float++) {
+    for(ImageMipFilter filter : {IMAGE_MIP_BOX, IMAGE_MIP_KAISER}) {
+      for(unsigned int threads_count : {1u, max_threads}) {
+        ImageMipChain chain;
+
+        auto start = std::chrono::steady_clock::now();
+        image_mip_build(&chain, as_float ? nullptr : big_pixels.data(), as_float ? big_linear.data() : nullptr, big_size, big_size, filter, threads_count);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        printf("MIPMAPS (%s %s, %2u threads): %.1f MP/s, %i levels, %zu bytes in one buffer\n", 
+               as_float ? "float" : "8 bit", filter_names[filter], threads_count, mip_megapixels / seconds, chain.levels_count, chain.data_size);
+
+        // Each level lives at `chain.data + chain.levels[i].data_offset`.
+        free(chain.data);
+      }
+    }
+  }
 }
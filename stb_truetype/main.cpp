@@ -1,12 +1,1339 @@
+#include <cstddef>
+
+/// stb_truetype lets us replace its allocator by defining `STBTT_malloc` and `STBTT_free` _before_ 
+/// including it. Both receive the `userdata` of the `stbtt_fontinfo` they're working with. We route 
+/// them to the per-thread scratch arenas further down (see `font_sdf_atlas_build`). With a `nullptr` 
+/// `userdata`, they behave exactly like `malloc` and `free`.
+
+static void* font_scratch_malloc(size_t size, void* user_data);
+static void font_scratch_free(void* ptr, void* user_data);
+
+#define STBTT_malloc(size, user_data) font_scratch_malloc(size, user_data)
+#define STBTT_free(ptr, user_data)    font_scratch_free(ptr, user_data)
+
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
-#include <cstdio>
-#include <cstdlib>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <deque>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FONT_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/// You can find the stb_truetype library at the link below: 
+///
+/// https://github.com/nothings/stb
+
+/// stb_truetype never copies the font data you give it. Every `stbtt_fontinfo` just points into 
+/// your buffer, and reads from it whenever it needs something. So the whole file doesn't actually 
+/// have to be read up front. If we memory-map the file instead, the OS hands us a pointer to its 
+/// contents, and only reads in the parts stb_truetype actually touches. For a 20MB CJK font where 
+/// a UI uses a few hundred glyphs, that's a big difference, both in startup time and in memory. 
+/// Mapped pages are also shared with every other process that maps the same font.
+///
+/// The registry below maps each font file once, and creates a `stbtt_fontinfo` for _every_ face in 
+/// it. A `.ttf` has one face, but a `.ttc` collection can have a dozen (all the weights of a family, 
+/// for example), and they all share the one mapping. No copies, no matter how many faces. 
+///
+/// The code below uses the POSIX `mmap`. On Windows, you can use `CreateFileMapping` and `MapViewOfFile` instead.
+
+struct FontFile {
+  std::string path;
+  const unsigned char* data; 
+  size_t size;
+};
+
+struct FontFace {
+  stbtt_fontinfo info;
+  const FontFile* file; 
+  int face_index; // The index to give `stbtt_GetFontOffsetForIndex` to get this face
+};
+
+/// The caches above key glyphs by `stbtt_fontinfo` pointer, so faces must never move once they're 
+/// added. A `std::deque` never moves its elements when it grows at the end, unlike a `std::vector`.
+
+struct FontRegistry {
+  std::deque<FontFile> files; 
+  std::deque<FontFace> faces;
+};
+
+/// Maps `path` and adds every face in it to `registry`. Adding a path that's already in the 
+/// registry does nothing. Returns the number of faces in the file, or 0 if it can't be mapped or 
+/// isn't a font.
+
+static int font_registry_add(FontRegistry* registry, const char* path) {
+  for(const FontFile& file : registry->files) {
+    if(file.path == path) {
+      int faces_count = 0;
+      for(const FontFace& face : registry->faces) {
+        faces_count += face.file == &file;
+      }
+
+      return faces_count;
+    }
+  }
+
+  int fd = open(path, O_RDONLY);
+  if(fd == -1) {
+    return 0;
+  }
+
+  struct stat file_stat;
+  if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+
+  void* data = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping stays valid after the file is closed
+  if(data == MAP_FAILED) {
+    return 0;
+  }
+
+  // stb_truetype jumps all over the file, so there's no point in the OS reading ahead.
+  madvise(data, (size_t)file_stat.st_size, MADV_RANDOM);
+
+  const unsigned char* font_data = (const unsigned char*)data;
+
+  int faces_count = stbtt_GetNumberOfFonts(font_data); // 1 for a `.ttf`, and 0 for anything that's not a font
+  if(faces_count <= 0) {
+    munmap(data, (size_t)file_stat.st_size);
+    return 0;
+  }
+
+  registry->files.push_back(FontFile{path, font_data, (size_t)file_stat.st_size});
+  const FontFile* file = &registry->files.back();
+
+  int added = 0;
+  for(int i = 0; i < faces_count; i++) {
+    FontFace face   = {};
+    face.file       = file;
+    face.face_index = i;
+
+    int offset = stbtt_GetFontOffsetForIndex(font_data, i);
+    if(offset < 0 || stbtt_InitFont(&face.info, font_data, offset) == 0) {
+      continue; // A broken face doesn't stop the others
+    }
+
+    registry->faces.push_back(face);
+    added++;
+  }
+
+  return added;
+}
+
+/// Returns face `face_index` of the file at `path`, or `nullptr` if the registry doesn't have it.
+
+static const stbtt_fontinfo* font_registry_find(const FontRegistry* registry, const char* path, int face_index) {
+  for(const FontFace& face : registry->faces) {
+    if(face.face_index == face_index && face.file->path == path) {
+      return &face.info;
+    }
+  }
+
+  return nullptr;
+}
+
+/// Unmaps every file. Every `stbtt_fontinfo` of the registry is invalid afterwards.
+
+static void font_registry_shutdown(FontRegistry* registry) {
+  for(FontFile& file : registry->files) {
+    munmap((void*)file.data, file.size);
+  }
+
+  registry->faces.clear();
+  registry->files.clear();
+}
+
+/// Rasterizing glyphs one at a time with `stbtt_GetGlyphBitmap` (like `main` does) means one 
+/// allocation per glyph, and one texture (or one upload) per glyph. Most renderers would much 
+/// rather have every glyph they need in _one_ texture, an "atlas", plus a table that says where 
+/// each glyph is in it. 
+///
+/// stb_truetype can build such an atlas for us with its "pack" API: `stbtt_PackBegin`, 
+/// `stbtt_PackFontRanges`, and `stbtt_PackEnd`. You give it ranges of codepoints (say, ASCII 
+/// and Latin-1), and it rasterizes every glyph into one big 8 bit buffer, filling an array of 
+/// `stbtt_packedchar`s (the position and metrics of each glyph in the atlas) as it goes. 
+///
+/// `stbtt_PackFontRanges` does everything on one thread, though. Under the hood, it's just three 
+/// steps that are public on their own, so we can do better:
+///
+///   1. `stbtt_PackFontRangesGatherRects` works out the size of every glyph's rectangle. Cheap.
+///   2. `stbtt_PackFontRangesPackRects` finds a spot in the atlas for every rectangle. Also cheap, 
+///      and it has to see every rectangle at once to pack them well.
+///   3. `stbtt_PackFontRangesRenderIntoRects` rasterizes every glyph into its rectangle. This is 
+///      where almost all of the time goes. 
+///
+/// The rectangles never overlap, so step 3 can run on every range at the same time, each on its 
+/// own thread. The only catch is that `stbtt_PackFontRangesRenderIntoRects` temporarily changes 
+/// the oversampling settings _inside_ the pack context while it works. So each thread gets its 
+/// own copy of the context. The copies still point to the same pixels, which is what we want.
+///
+/// Oversampling rasterizes each glyph at 2x (or more) the resolution horizontally and/or 
+/// vertically, and then filters it back down. It makes small text look much better when it's 
+/// drawn at sub-pixel positions, at the cost of a bigger atlas. Each range picks its own.
+
+struct FontAtlasRange {
+  int first_codepoint; 
+  int codepoints_count;
+  float font_size;            // In pixels, like `stbtt_ScaleForPixelHeight`
+
+  unsigned char h_oversample; // 1 means no oversampling
+  unsigned char v_oversample;
+
+  size_t chars_offset;        // Where this range's glyphs start in `FontAtlas.chars` (filled by `font_atlas_build`)
+};
+
+struct FontAtlas {
+  unsigned char* pixels; // 8 bits per pixel, `width * height` bytes. Free it with `free`.
+  int width; 
+  int height;
+
+  std::vector<FontAtlasRange> ranges; 
+  std::vector<stbtt_packedchar> chars; // One per codepoint of every range, in order
+
+  float fill_ratio;   // How much of the atlas is covered by glyphs, from 0 to 1
+  int missing_count;  // Glyphs that didn't fit in the atlas
+};
+
+/// Runs `task(index)` for every index on `threads_count` threads. The threads just grab the next 
+/// index from a shared counter, so a thread that finishes early simply takes more work.
+
+static void font_parallel_for(unsigned int threads_count, size_t tasks_count, const std::function<void(size_t)>& task) {
+  std::atomic<size_t> next_task(0);
+
+  auto worker = [&]() {
+    for(size_t index = next_task.fetch_add(1); index < tasks_count; index = next_task.fetch_add(1)) {
+      task(index);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int i = 1; i < threads_count; i++) {
+    threads.emplace_back(worker);
+  }
+
+  worker(); // The calling thread helps out as well
+
+  for(std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Builds an atlas of `width` by `height` pixels out of `ranges`, with `padding` empty pixels 
+/// around every glyph (1 is usually enough to keep bilinear filtering from bleeding neighbors in). 
+///
+/// Returns `false` if the font can't be parsed. Glyphs that don't fit are counted in 
+/// `missing_count`, and their `stbtt_packedchar` is left zeroed.
+
+static bool font_atlas_build(FontAtlas* atlas, const stbtt_fontinfo* info, const FontAtlasRange* ranges, size_t ranges_count, 
+                             int width, int height, int padding, unsigned int threads_count) {
+  atlas->width         = width;
+  atlas->height        = height;
+  atlas->pixels        = (unsigned char*)calloc((size_t)width * height, 1);
+  atlas->fill_ratio    = 0.0f;
+  atlas->missing_count = 0;
+  atlas->ranges.assign(ranges, ranges + ranges_count);
+
+  size_t chars_count = 0;
+  for(FontAtlasRange& range : atlas->ranges) {
+    range.chars_offset = chars_count;
+    chars_count       += range.codepoints_count;
+  }
+
+  atlas->chars.assign(chars_count, stbtt_packedchar{});
+
+  stbtt_pack_context context;
+  if(!atlas->pixels || stbtt_PackBegin(&context, atlas->pixels, width, height, 0, padding, nullptr) == 0) {
+    return false;
+  }
+
+  /// Step 1. Every range is gathered with its own oversampling settings, which get stored in the 
+  /// `stbtt_pack_range` so step 3 can find them again.
+
+  std::vector<stbtt_pack_range> pack_ranges(ranges_count);
+  std::vector<stbrp_rect> rects(chars_count);
+  std::vector<size_t> rects_offsets(ranges_count);
+
+  size_t rects_count = 0;
+  for(size_t i = 0; i < ranges_count; i++) {
+    const FontAtlasRange& range = atlas->ranges[i];
+
+    pack_ranges[i]                                  = stbtt_pack_range{};
+    pack_ranges[i].font_size                        = range.font_size;
+    pack_ranges[i].first_unicode_codepoint_in_range = range.first_codepoint;
+    pack_ranges[i].num_chars                        = range.codepoints_count;
+    pack_ranges[i].chardata_for_range               = atlas->chars.data() + range.chars_offset;
+
+    stbtt_PackSetOversampling(&context, range.h_oversample, range.v_oversample);
+
+    rects_offsets[i] = rects_count;
+    rects_count     += stbtt_PackFontRangesGatherRects(&context, info, &pack_ranges[i], 1, rects.data() + rects_count);
+  }
+
+  /// Step 2, on all of the rectangles at once.
+
+  stbtt_PackFontRangesPackRects(&context, rects.data(), (int)rects_count);
+
+  /// Step 3, one range per task. Each task works on its own copy of the context.
+
+  font_parallel_for(threads_count, ranges_count, [&](size_t i) {
+    stbtt_pack_context thread_context = context;
+    stbtt_PackFontRangesRenderIntoRects(&thread_context, info, &pack_ranges[i], 1, rects.data() + rects_offsets[i]);
+  });
+
+  stbtt_PackEnd(&context);
+
+  /// How well did we do? The fill ratio counts the area of every packed rectangle (padding and 
+  /// oversampling included, since that space is taken either way).
+
+  size_t filled_area = 0;
+  for(size_t i = 0; i < rects_count; i++) {
+    if(rects[i].was_packed) {
+      filled_area += (size_t)rects[i].w * rects[i].h;
+    }
+    else {
+      atlas->missing_count++;
+    }
+  }
+
+  atlas->fill_ratio = (float)((double)filled_area / ((double)width * height));
+  return true;
+}
+
+/// Finds the packed glyph of `codepoint` at `font_size`. Returns `nullptr` if no range has it.
+
+static const stbtt_packedchar* font_atlas_find(const FontAtlas* atlas, int codepoint, float font_size) {
+  for(const FontAtlasRange& range : atlas->ranges) {
+    if(range.font_size == font_size && codepoint >= range.first_codepoint && codepoint < range.first_codepoint + range.codepoints_count) {
+      return &atlas->chars[range.chars_offset + (codepoint - range.first_codepoint)];
+    }
+  }
+
+  return nullptr;
+}
+
+/// An atlas works great for Latin text, where a few hundred glyphs cover pretty much everything. 
+/// CJK fonts have tens of thousands of glyphs, though, so packing all of them up front (at every 
+/// size!) is out of the question. Instead, glyphs are rasterized as text needs them. But calling 
+/// `stbtt_GetGlyphBitmap` and `stbtt_FreeBitmap` every frame for the same glyphs means rasterizing 
+/// (and allocating) the same bitmaps over and over again.
+///
+/// The cache below keeps rasterized glyphs around, keyed by font, glyph index, and scale (what 
+/// `stbtt_ScaleForPixelHeight` returns). It lives within a fixed memory budget:
+///
+///   - Bitmaps are stored in fixed-size "pages" (slabs). A new glyph goes at the end of the current 
+///     page, with `stbtt_MakeGlyphBitmap` rasterizing straight into it, so there's no allocation per glyph.
+///   - Pages are allocated as needed until the budget is reached. After that, the least recently 
+///     used page is emptied (evicting every glyph in it) and reused. Evicting whole pages means 
+///     there's never any fragmentation to deal with. Hot glyphs that got evicted along with cold 
+///     ones simply end up together in the newest page, so they tend to stay hot together.
+///   - The lookup table and the glyph records are allocated once, in `font_glyph_cache_init`.
+///
+/// So once the glyphs of your text are in the cache, drawing it does zero rasterization and zero 
+/// allocations. (stb_truetype still allocates its rasterizer scratch memory on a miss.)
+///
+/// Call `font_glyph_cache_begin_frame` at the start of every frame. Pages used during the current 
+/// frame are never evicted, so every bitmap you get stays valid until the end of the frame. If a 
+/// frame needs more glyphs than the budget can hold, `font_glyph_cache_get` fails instead.
+
+#define FONT_GLYPH_PAGE_SIZE (128 * 1024) // A 256 pixel glyph is about 64KB, so even the big ones fit
+
+struct FontGlyphKey {
+  const stbtt_fontinfo* font; 
+  int glyph_index; 
+  float scale;
+};
+
+/// What `font_glyph_cache_get` gives back. `offset_x` and `offset_y` are the same as the ones 
+/// `stbtt_GetGlyphBitmap` returns. Empty glyphs (like spaces) have a width and height of 0.
+
+struct FontCachedGlyph {
+  const unsigned char* pixels; // `width * height` bytes, one byte per pixel
+  int width; 
+  int height; 
+  int offset_x; 
+  int offset_y;
+};
+
+struct FontGlyphRecord {
+  FontGlyphKey key; 
+  FontCachedGlyph glyph;
+
+  int page;         // The page the pixels live in
+  int next_in_page; // The next record in the same page, or -1
+};
+
+struct FontGlyphPage {
+  unsigned char* memory; 
+  size_t used;
+
+  unsigned long long last_used;  // The cache's `clock` the last time a glyph in this page was used
+  unsigned long long last_frame; // The frame it was last used in
+  int first_record;              // The records living in this page, as a linked list through `next_in_page`
+};
+
+struct FontGlyphCache {
+  std::vector<FontGlyphRecord> records; 
+  std::vector<int> free_records; 
+
+  /// An open-addressing hash table of indices into `records` (-1 for empty slots), with linear 
+  /// probing. It's always at most half full.
+  std::vector<int> table; 
+  size_t table_mask;
+
+  std::vector<FontGlyphPage> pages; 
+  size_t max_pages; 
+  int current_page; 
+
+  unsigned long long clock; 
+  unsigned long long frame;
+
+  size_t hits; 
+  size_t misses; 
+  size_t evictions; // Pages emptied to make room
+};
+
+/// `budget` is the most memory the bitmaps can take, in bytes, and `max_glyphs` the most glyphs 
+/// the cache will hold at once.
+
+static void font_glyph_cache_init(FontGlyphCache* cache, size_t budget, size_t max_glyphs) {
+  size_t table_size = 1;
+  while(table_size < max_glyphs * 2) {
+    table_size *= 2;
+  }
+
+  cache->records.assign(max_glyphs, FontGlyphRecord{});
+  cache->free_records.clear();
+  cache->free_records.reserve(max_glyphs);
+  for(size_t i = max_glyphs; i > 0; i--) {
+    cache->free_records.push_back((int)i - 1);
+  }
+
+  cache->table.assign(table_size, -1);
+  cache->table_mask = table_size - 1;
+
+  cache->max_pages = budget / FONT_GLYPH_PAGE_SIZE > 0 ? budget / FONT_GLYPH_PAGE_SIZE : 1;
+  cache->pages.clear();
+  cache->pages.reserve(cache->max_pages);
+  cache->current_page = -1;
+
+  cache->clock     = 0;
+  cache->frame     = 1;
+  cache->hits      = 0;
+  cache->misses    = 0;
+  cache->evictions = 0;
+}
+
+static void font_glyph_cache_shutdown(FontGlyphCache* cache) {
+  for(FontGlyphPage& page : cache->pages) {
+    free(page.memory);
+  }
+
+  cache->pages.clear();
+}
+
+static void font_glyph_cache_begin_frame(FontGlyphCache* cache) {
+  cache->frame++;
+}
+
+static size_t font_glyph_hash(const FontGlyphKey& key) {
+  unsigned int scale_bits;
+  memcpy(&scale_bits, &key.scale, sizeof(scale_bits));
+
+  unsigned long long hash = (unsigned long long)(uintptr_t)key.font;
+  hash = (hash ^ (unsigned long long)key.glyph_index) * 0x9E3779B97F4A7C15ull;
+  hash = (hash ^ scale_bits) * 0x9E3779B97F4A7C15ull;
+
+  return (size_t)(hash ^ (hash >> 32));
+}
+
+static bool font_glyph_key_equals(const FontGlyphKey& a, const FontGlyphKey& b) {
+  return a.font == b.font && a.glyph_index == b.glyph_index && a.scale == b.scale;
+}
+
+/// Removes a record from the hash table. With linear probing, we can't just leave a hole behind, 
+/// since it would cut off the records that probed past it. So the records after the hole get 
+/// shifted back into it when they're allowed to be there ("backward shift deletion").
+
+static void font_glyph_table_remove(FontGlyphCache* cache, int record) {
+  size_t slot = font_glyph_hash(cache->records[record].key) & cache->table_mask;
+  while(cache->table[slot] != record) {
+    slot = (slot + 1) & cache->table_mask;
+  }
+
+  size_t hole = slot;
+  for(size_t next = (hole + 1) & cache->table_mask; cache->table[next] != -1; next = (next + 1) & cache->table_mask) {
+    size_t home = font_glyph_hash(cache->records[cache->table[next]].key) & cache->table_mask;
+
+    // Can the record at `next` move back to `hole`? Only if its home slot isn't between the two.
+    bool can_move = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+    if(can_move) {
+      cache->table[hole] = cache->table[next];
+      hole               = next;
+    }
+  }
+
+  cache->table[hole] = -1;
+}
+
+/// Empties the least recently used page that wasn't used this frame, and returns it. Returns -1 
+/// if every page was used this frame.
+
+static int font_glyph_cache_evict(FontGlyphCache* cache) {
+  int victim = -1;
+
+  for(size_t i = 0; i < cache->pages.size(); i++) {
+    const FontGlyphPage& page = cache->pages[i];
+    if(page.last_frame != cache->frame && (victim == -1 || page.last_used < cache->pages[victim].last_used)) {
+      victim = (int)i;
+    }
+  }
+
+  if(victim == -1) {
+    return -1;
+  }
+
+  FontGlyphPage& page = cache->pages[victim];
+  for(int record = page.first_record; record != -1; ) {
+    int next = cache->records[record].next_in_page;
+
+    font_glyph_table_remove(cache, record);
+    cache->free_records.push_back(record);
+
+    record = next;
+  }
+
+  page.used         = 0;
+  page.first_record = -1;
+  page.last_used    = ++cache->clock; // It's about to be filled again, so it counts as fresh
+
+  cache->evictions++;
+  return victim;
+}
+
+/// Finds a page with `size` free bytes: the current page, a new page (while under budget), or 
+/// an evicted one. Returns -1 if none can be found.
+
+static int font_glyph_cache_find_page(FontGlyphCache* cache, size_t size) {
+  if(cache->current_page != -1 && cache->pages[cache->current_page].used + size <= FONT_GLYPH_PAGE_SIZE) {
+    return cache->current_page;
+  }
+
+  int page = -1;
+  if(cache->pages.size() < cache->max_pages) {
+    unsigned char* memory = (unsigned char*)malloc(FONT_GLYPH_PAGE_SIZE);
+    if(memory) {
+      cache->pages.push_back(FontGlyphPage{memory, 0, 0, 0, -1});
+      page = (int)cache->pages.size() - 1;
+    }
+  }
+
+  if(page == -1) {
+    page = font_glyph_cache_evict(cache);
+  }
+
+  if(page != -1) {
+    cache->current_page = page;
+  }
+
+  return page;
+}
+
+/// Returns the bitmap of `glyph_index` at `scale`, rasterizing it on a miss. Returns `false` if 
+/// the glyph doesn't fit in a page, or if the budget is already taken by glyphs of this frame.
+
+static bool font_glyph_cache_get(FontGlyphCache* cache, const stbtt_fontinfo* font, int glyph_index, float scale, FontCachedGlyph* glyph) {
+  FontGlyphKey key = {font, glyph_index, scale};
+  size_t slot      = font_glyph_hash(key) & cache->table_mask;
+
+  for(; cache->table[slot] != -1; slot = (slot + 1) & cache->table_mask) {
+    FontGlyphRecord& record = cache->records[cache->table[slot]];
+    if(!font_glyph_key_equals(record.key, key)) {
+      continue;
+    }
+
+    FontGlyphPage& page = cache->pages[record.page];
+    page.last_used      = ++cache->clock;
+    page.last_frame     = cache->frame;
+
+    cache->hits++;
+    *glyph = record.glyph;
+    return true;
+  }
+
+  /// A miss. First, the size of the bitmap, so we know how much room it needs.
+
+  cache->misses++;
+
+  int x0, y0, x1, y1;
+  stbtt_GetGlyphBitmapBox(font, glyph_index, scale, scale, &x0, &y0, &x1, &y1);
+
+  size_t size = (size_t)(x1 - x0) * (y1 - y0);
+  if(size > FONT_GLYPH_PAGE_SIZE) {
+    return false;
+  }
+
+  // Out of records? Then we make room the same way we do for pixels.
+  while(cache->free_records.empty()) {
+    int page = font_glyph_cache_evict(cache);
+    if(page == -1) {
+      return false;
+    }
+
+    cache->current_page = page;
+  }
+
+  int page_index = font_glyph_cache_find_page(cache, size);
+  if(page_index == -1) {
+    return false;
+  }
+
+  /// The eviction above might have emptied the slot we probed to, so the slot is looked up again.
+
+  slot = font_glyph_hash(key) & cache->table_mask;
+  while(cache->table[slot] != -1) {
+    slot = (slot + 1) & cache->table_mask;
+  }
+
+  int record_index = cache->free_records.back();
+  cache->free_records.pop_back();
+
+  FontGlyphPage& page     = cache->pages[page_index];
+  FontGlyphRecord& record = cache->records[record_index];
+
+  record.key          = key;
+  record.glyph        = FontCachedGlyph{page.memory + page.used, x1 - x0, y1 - y0, x0, y0};
+  record.page         = page_index;
+  record.next_in_page = page.first_record;
+
+  if(size > 0) {
+    stbtt_MakeGlyphBitmap(font, page.memory + page.used, record.glyph.width, record.glyph.height, record.glyph.width, scale, scale, glyph_index);
+  }
+
+  page.used        += size;
+  page.first_record = record_index;
+  page.last_used    = ++cache->clock;
+  page.last_frame   = cache->frame;
+
+  cache->table[slot] = record_index;
+
+  *glyph = record.glyph;
+  return true;
+}
+
+/// `stbtt_GetGlyphKernAdvance` searches the font's kerning data every time it's called, and text 
+/// layout calls it for every pair of glyphs. That's a binary search through the `kern` table at 
+/// best, and a walk through the much more complex `GPOS` table at worst.
+///
+/// The index below turns that into one hash table lookup. Each pair of glyphs is packed into a 
+/// single 32 bit key (glyph indices are 16 bits in TrueType), and stored in an open-addressing 
+/// table with linear probing, next to its advance. 
+///
+/// There's one catch. `stbtt_GetKerningTable` only reads the old `kern` table, but when a font also 
+/// has a `GPOS` table, `stbtt_GetGlyphKernAdvance` uses that one instead (and most modern fonts only 
+/// have `GPOS`). There's no public API to list every pair in `GPOS`, so for those fonts the index 
+/// fills itself lazily: the first time a pair is asked for, it's looked up with `stbtt_GetGlyphKernAdvance` 
+/// and remembered (even when it's 0). Text only ever uses a few thousand different pairs, so it 
+/// quickly stops missing. Either way, the index gives the exact same results as stb_truetype.
+///
+/// A lazy index writes to itself on lookups, so it shouldn't be shared between threads. An eager 
+/// one (`is_lazy == false`) never changes after `font_kern_index_build`.
+
+#define FONT_KERN_EMPTY_KEY 0xFFFFFFFFu // Glyph 65535 kerned with itself, which no font has
+
+struct FontKernIndex {
+  std::vector<unsigned int> keys; // `(glyph1 << 16) | glyph2`, or `FONT_KERN_EMPTY_KEY`
+  std::vector<int> advances;      // Unscaled, like `stbtt_GetGlyphKernAdvance`
+  size_t mask; 
+  size_t count;
+
+  const stbtt_fontinfo* font; 
+  bool is_lazy;
+};
+
+static size_t font_kern_slot(unsigned int key, size_t mask) {
+  return (size_t)(((unsigned long long)key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+static void font_kern_index_insert(FontKernIndex* index, unsigned int key, int advance);
+
+/// Doubles the size of the table, and puts every pair back in.
+
+static void font_kern_index_grow(FontKernIndex* index) {
+  std::vector<unsigned int> old_keys;
+  std::vector<int> old_advances;
+  old_keys.swap(index->keys);
+  old_advances.swap(index->advances);
+
+  size_t capacity = old_keys.empty() ? 256 : old_keys.size() * 2;
+  index->keys.assign(capacity, FONT_KERN_EMPTY_KEY);
+  index->advances.assign(capacity, 0);
+  index->mask  = capacity - 1;
+  index->count = 0;
+
+  for(size_t i = 0; i < old_keys.size(); i++) {
+    if(old_keys[i] != FONT_KERN_EMPTY_KEY) {
+      font_kern_index_insert(index, old_keys[i], old_advances[i]);
+    }
+  }
+}
+
+static void font_kern_index_insert(FontKernIndex* index, unsigned int key, int advance) {
+  if((index->count + 1) * 2 > index->keys.size()) {
+    font_kern_index_grow(index);
+  }
+
+  size_t slot = font_kern_slot(key, index->mask);
+  while(index->keys[slot] != FONT_KERN_EMPTY_KEY && index->keys[slot] != key) {
+    slot = (slot + 1) & index->mask;
+  }
+
+  index->count          += index->keys[slot] == FONT_KERN_EMPTY_KEY;
+  index->keys[slot]      = key;
+  index->advances[slot]  = advance;
+}
+
+static void font_kern_index_build(FontKernIndex* index, const stbtt_fontinfo* font) {
+  index->keys.clear();
+  index->advances.clear();
+  index->mask    = 0;
+  index->count   = 0;
+  index->font    = font;
+  index->is_lazy = font->gpos != 0;
+
+  font_kern_index_grow(index);
+
+  if(index->is_lazy) {
+    return;
+  }
+
+  int length = stbtt_GetKerningTableLength(font);
+  std::vector<stbtt_kerningentry> table(length);
+  length = stbtt_GetKerningTable(font, table.data(), length);
+
+  for(int i = 0; i < length; i++) {
+    font_kern_index_insert(index, ((unsigned int)table[i].glyph1 << 16) | (unsigned int)table[i].glyph2, table[i].advance);
+  }
+}
+
+/// The kerning between `glyph1` and the `glyph2` that follows it, unscaled. Same as `stbtt_GetGlyphKernAdvance`.
+
+static int font_kern_index_get(FontKernIndex* index, int glyph1, int glyph2) {
+  unsigned int key = ((unsigned int)glyph1 << 16) | (unsigned int)glyph2;
+
+  for(size_t slot = font_kern_slot(key, index->mask); index->keys[slot] != FONT_KERN_EMPTY_KEY; slot = (slot + 1) & index->mask) {
+    if(index->keys[slot] == key) {
+      return index->advances[slot];
+    }
+  }
+
+  if(!index->is_lazy) {
+    return 0; // Not in the table means no kerning
+  }
+
+  int advance = stbtt_GetGlyphKernAdvance(index->font, glyph1, glyph2);
+  font_kern_index_insert(index, key, advance);
+
+  return advance;
+}
+
+/// Every `stbtt_FindGlyphIndex` call walks the font's `cmap` table (a binary search, for most 
+/// fonts), and every `stbtt_GetGlyphHMetrics` call reads the `hmtx` table. Text layout does both 
+/// for every character of every string. But the answers never change, so we can look them up once 
+/// and keep them in flat arrays. 
+///
+/// Unicode goes up to 0x10FFFF, so one flat array of every codepoint would be way too big. Instead, 
+/// codepoints are split into pages of 256: a table of page pointers, and then the pages themselves. 
+/// A page is only filled in (all of its 256 codepoints at once) the first time one of its codepoints 
+/// is looked up. A Latin text ends up with one or two pages, and even a big CJK text only touches 
+/// a hundred or so. 
+///
+/// Each entry of a page holds the glyph index _and_ its advance, so going from a character to its 
+/// glyph and advance is two loads: the page pointer, and then the entry. For code that already has 
+/// glyph indices, the advance and left side bearing of every glyph are in flat arrays as well.
+///
+/// Filling pages lazily means lookups can write to the map. If several threads share a map, fill 
+/// the pages they'll need up front with `font_glyph_map_prefill` (the whole BMP takes 256 pages, 
+/// or about 1MB).
+
+#define FONT_MAX_CODEPOINT     0x110000
+#define FONT_GLYPH_MAP_PAGE    256
+#define FONT_GLYPH_MAP_PAGES   (FONT_MAX_CODEPOINT / FONT_GLYPH_MAP_PAGE)
+
+struct FontGlyphMapEntry {
+  unsigned short glyph_index; // 0 if the font doesn't have the codepoint
+  unsigned short advance;     // Unscaled, like `stbtt_GetGlyphHMetrics` (the `hmtx` table stores it as 16 bits too)
+};
+
+struct FontGlyphMap {
+  const stbtt_fontinfo* font;
+  std::vector<FontGlyphMapEntry*> pages; // `nullptr` for pages that haven't been filled yet
+
+  std::vector<int> advances;           // Indexed by glyph, unscaled
+  std::vector<int> left_side_bearings; // Indexed by glyph, unscaled
+};
+
+static void font_glyph_map_init(FontGlyphMap* map, const stbtt_fontinfo* font) {
+  map->font = font;
+  map->pages.assign(FONT_GLYPH_MAP_PAGES, nullptr);
+
+  map->advances.resize(font->numGlyphs);
+  map->left_side_bearings.resize(font->numGlyphs);
+
+  for(int glyph = 0; glyph < font->numGlyphs; glyph++) {
+    stbtt_GetGlyphHMetrics(font, glyph, &map->advances[glyph], &map->left_side_bearings[glyph]);
+  }
+}
+
+static void font_glyph_map_shutdown(FontGlyphMap* map) {
+  for(FontGlyphMapEntry* page : map->pages) {
+    free(page);
+  }
+
+  map->pages.clear();
+}
+
+/// Returns `nullptr` if the page couldn't be allocated. The page then stays empty, and lookups 
+/// fall back to stb_truetype.
+
+static FontGlyphMapEntry* font_glyph_map_fill_page(FontGlyphMap* map, int page_index) {
+  FontGlyphMapEntry* page = (FontGlyphMapEntry*)malloc(sizeof(FontGlyphMapEntry) * FONT_GLYPH_MAP_PAGE);
+  if(!page) {
+    return nullptr;
+  }
+
+  for(int i = 0; i < FONT_GLYPH_MAP_PAGE; i++) {
+    int glyph = stbtt_FindGlyphIndex(map->font, page_index * FONT_GLYPH_MAP_PAGE + i);
+    page[i]   = FontGlyphMapEntry{(unsigned short)glyph, (unsigned short)map->advances[glyph]};
+  }
+
+  map->pages[page_index] = page;
+  return page;
+}
+
+/// Fills every page covering the codepoints `[first, last]`.
+
+static void font_glyph_map_prefill(FontGlyphMap* map, int first, int last) {
+  for(int page = first / FONT_GLYPH_MAP_PAGE; page <= last / FONT_GLYPH_MAP_PAGE && page < FONT_GLYPH_MAP_PAGES; page++) {
+    if(!map->pages[page]) {
+      font_glyph_map_fill_page(map, page);
+    }
+  }
+}
+
+/// The glyph and advance of `codepoint`. Codepoints outside of Unicode give glyph 0, the 
+/// "missing glyph" box, same as `stbtt_FindGlyphIndex`.
+
+static inline FontGlyphMapEntry font_glyph_map_get(FontGlyphMap* map, int codepoint) {
+  if((unsigned int)codepoint >= FONT_MAX_CODEPOINT) {
+    return FontGlyphMapEntry{0, (unsigned short)map->advances[0]};
+  }
+
+  FontGlyphMapEntry* page = map->pages[codepoint / FONT_GLYPH_MAP_PAGE];
+  if(!page) {
+    page = font_glyph_map_fill_page(map, codepoint / FONT_GLYPH_MAP_PAGE);
+  }
+
+  if(!page) {
+    int glyph = stbtt_FindGlyphIndex(map->font, codepoint);
+    return FontGlyphMapEntry{(unsigned short)glyph, (unsigned short)map->advances[glyph]};
+  }
+
+  return page[codepoint % FONT_GLYPH_MAP_PAGE];
+}
+
+/// Bitmap glyphs are rasterized for one size. A UI that draws text at many sizes needs a separate 
+/// bitmap for each one. A signed distance field (SDF) glyph instead stores, for every pixel, how 
+/// far it is from the outline of the glyph. A shader can then draw it sharply at pretty much any 
+/// size from a single atlas, with a `smoothstep` around `onedge_value`. stb_truetype makes SDF 
+/// glyphs with `stbtt_GetGlyphSDF`.
+///
+/// SDF glyphs are much more expensive to make than bitmaps, though, so the atlas below spreads 
+/// the glyphs over several threads:
+///
+///   1. The main thread works out the size of every glyph's SDF (its bitmap box, plus the padding 
+///      the distance field spills into), and packs the rectangles with the same packer the pack API 
+///      uses (`stbtt_PackFontRangesPackRects`).
+///   2. The threads then take glyphs one at a time, generate their SDF, and copy it into their 
+///      rectangle. The rectangles don't overlap, so the threads never wait on each other.
+///
+/// `stbtt_GetGlyphSDF` allocates quite a bit for every glyph: the outline, some precomputed data, 
+/// and the SDF itself. All of it goes through `STBTT_malloc`, which receives the `userdata` of the 
+/// `stbtt_fontinfo` (we defined it at the top of this file). So every thread gets its own shallow 
+/// copy of the `stbtt_fontinfo` (sharing the font data) whose `userdata` points to the thread's 
+/// own scratch arena. Every allocation for a glyph becomes a pointer bump, and the arena is reset 
+/// once the glyph is in the atlas. Fonts with a `nullptr` `userdata` (like `info` in `main`) keep 
+/// using `malloc` and `free`.
+
+#define FONT_SCRATCH_CAPACITY (1024 * 1024)
+
+struct FontScratch {
+  unsigned char* memory; 
+  size_t capacity; 
+  size_t offset; 
+  size_t last_offset; // Where the most recent allocation started
+
+  size_t heap_fallbacks; // Allocations that didn't fit
+};
+
+static void* font_scratch_malloc(size_t size, void* user_data) {
+  FontScratch* scratch = (FontScratch*)user_data;
+  if(!scratch) {
+    return malloc(size);
+  }
+
+  size_t aligned_size = (size + 15) & ~(size_t)15;
+  if(scratch->offset + aligned_size > scratch->capacity) {
+    scratch->heap_fallbacks++;
+    return malloc(size);
+  }
+
+  scratch->last_offset = scratch->offset;
+  scratch->offset     += aligned_size;
+
+  return scratch->memory + scratch->last_offset;
+}
+
+static void font_scratch_free(void* ptr, void* user_data) {
+  FontScratch* scratch = (FontScratch*)user_data;
+  bool is_scratch      = scratch && (unsigned char*)ptr >= scratch->memory && (unsigned char*)ptr < scratch->memory + scratch->capacity;
+
+  if(!is_scratch) {
+    free(ptr);
+    return;
+  }
+
+  // Only the most recent allocation can actually be given back. Everything else waits for the reset.
+  if((unsigned char*)ptr == scratch->memory + scratch->last_offset) {
+    scratch->offset = scratch->last_offset;
+  }
+}
+
+struct FontScratchOwner {
+  FontScratch scratch = {};
+
+  ~FontScratchOwner() {
+    free(scratch.memory);
+  }
+};
+
+/// Returns the scratch arena of the calling thread, creating it the first time it's used on that thread.
+
+static FontScratch* font_scratch_get_thread() {
+  static thread_local FontScratchOwner owner;
+
+  if(!owner.scratch.memory) {
+    owner.scratch.memory   = (unsigned char*)malloc(FONT_SCRATCH_CAPACITY);
+    owner.scratch.capacity = owner.scratch.memory ? FONT_SCRATCH_CAPACITY : 0;
+  }
+
+  return &owner.scratch;
+}
 
-/// You can find the stb_truetype library at the link below: 
+/// One glyph of an SDF atlas. Everything is in pixels at the atlas' `font_size`, so multiply by 
+/// `your_size / atlas.font_size` when drawing at another size.
+
+struct FontSdfGlyph {
+  int codepoint; 
+  int glyph_index; 
+
+  int x, y;          // Top-left corner of the glyph in the atlas
+  int width, height; // 0 for empty glyphs (like spaces)
+  int offset_x;      // From the pen position to the top-left corner, like `stbtt_GetGlyphBitmap`
+  int offset_y; 
+  float advance;
+};
+
+struct FontSdfAtlas {
+  unsigned char* pixels; // 8 bits per pixel, `width * height` bytes. Free it with `free`.
+  int width; 
+  int height;
+
+  float font_size;             // The size the distances were computed at, in pixels
+  int padding;                 // How far (in pixels) the field reaches outside of the outline
+  unsigned char onedge_value;  // The value right on the outline
+  float pixel_dist_scale;      // How much the value changes per pixel of distance
+
+  std::vector<FontSdfGlyph> glyphs; // One per codepoint given to `font_sdf_atlas_build`, in order
+  int missing_count;                // Glyphs that didn't fit in the atlas
+};
+
+/// Builds an SDF atlas of `width` by `height` pixels for `codepoints`, at `font_size` pixels. 
+/// With a `padding` of 8 and `onedge_value` of 128, the field covers 8 pixels on both sides of 
+/// the outline. Returns `false` if `padding` isn't positive (the field needs some room to fall off 
+/// in), or if the atlas couldn't be allocated.
+
+static bool font_sdf_atlas_build(FontSdfAtlas* atlas, const stbtt_fontinfo* info, const int* codepoints, size_t codepoints_count, 
+                                 float font_size, int padding, int width, int height, unsigned int threads_count) {
+  atlas->pixels = nullptr;
+  if(padding <= 0) {
+    return false;
+  }
+
+  atlas->width            = width;
+  atlas->height           = height;
+  atlas->font_size        = font_size;
+  atlas->padding          = padding;
+  atlas->onedge_value     = 128;
+  atlas->pixel_dist_scale = 128.0f / padding;
+  atlas->missing_count    = 0;
+  atlas->glyphs.assign(codepoints_count, FontSdfGlyph{});
+
+  atlas->pixels = (unsigned char*)calloc((size_t)width * height, 1);
+  if(!atlas->pixels) {
+    return false;
+  }
+
+  float scale = stbtt_ScaleForPixelHeight(info, font_size);
+
+  /// Step 1. The size of every SDF is the bitmap box grown by `padding` on every side (that's 
+  /// what `stbtt_GetGlyphSDF` does too). The extra pixel keeps neighbors from touching.
+
+  std::vector<stbrp_rect> rects(codepoints_count);
+
+  for(size_t i = 0; i < codepoints_count; i++) {
+    FontSdfGlyph& glyph = atlas->glyphs[i];
+    glyph.codepoint     = codepoints[i];
+    glyph.glyph_index   = stbtt_FindGlyphIndex(info, codepoints[i]);
+
+    int advance, bearing;
+    stbtt_GetGlyphHMetrics(info, glyph.glyph_index, &advance, &bearing);
+    glyph.advance = advance * scale;
+
+    rects[i]    = stbrp_rect{};
+    rects[i].id = (int)i;
+
+    if(stbtt_IsGlyphEmpty(info, glyph.glyph_index)) {
+      continue;
+    }
+
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBox(info, glyph.glyph_index, scale, scale, &x0, &y0, &x1, &y1);
+
+    rects[i].w = (x1 - x0) + padding * 2 + 1;
+    rects[i].h = (y1 - y0) + padding * 2 + 1;
+  }
+
+  stbtt_pack_context context;
+  stbtt_PackBegin(&context, atlas->pixels, width, height, 0, 0, nullptr);
+  stbtt_PackFontRangesPackRects(&context, rects.data(), (int)rects.size());
+  stbtt_PackEnd(&context);
+
+  for(const stbrp_rect& rect : rects) {
+    atlas->missing_count += rect.w != 0 && !rect.was_packed;
+  }
+
+  /// Step 2, one glyph per task.
+
+  font_parallel_for(threads_count, codepoints_count, [&](size_t i) {
+    FontSdfGlyph& glyph = atlas->glyphs[i];
+    if(rects[i].w == 0 || !rects[i].was_packed) {
+      return;
+    }
+
+    FontScratch* scratch       = font_scratch_get_thread();
+    stbtt_fontinfo thread_info = *info;
+    thread_info.userdata       = scratch;
+
+    unsigned char* sdf = stbtt_GetGlyphSDF(&thread_info, scale, glyph.glyph_index, padding, atlas->onedge_value, atlas->pixel_dist_scale, 
+                                           &glyph.width, &glyph.height, &glyph.offset_x, &glyph.offset_y);
+    if(sdf) {
+      glyph.x = rects[i].x;
+      glyph.y = rects[i].y;
+
+      for(int row = 0; row < glyph.height; row++) {
+        memcpy(atlas->pixels + (size_t)(glyph.y + row) * width + glyph.x, sdf + (size_t)row * glyph.width, glyph.width);
+      }
+
+      stbtt_FreeSDF(sdf, scratch);
+    }
+
+    scratch->offset      = 0;
+    scratch->last_offset = 0;
+  });
+
+  return true;
+}
+
+/// Putting the pieces above together: a text layout engine for when there's a _lot_ of text to 
+/// measure and wrap every frame (think tens of thousands of labels and table cells). 
 ///
-/// https://github.com/nothings/stb
+/// The way `main` does it (one `stbtt_GetGlyphHMetrics` and `stbtt_GetGlyphKernAdvance` per glyph, 
+/// scaled with `int` truncation) is slow, and the truncation adds up to a visible error on long 
+/// lines. The engine below lays out whole UTF-8 strings at once, in `float`, in three passes:
+///
+///   1. Decode the UTF-8, and turn every character into its glyph, its advance, and its "step": 
+///      how far its pen position is from the previous glyph's, which is the previous glyph's 
+///      advance plus the kerning between the two (just like stb_truetype's own 
+///      `xpos += advance; xpos += kern`). This uses the glyph map and the kerning index, so there 
+///      are no stb_truetype calls at all, once they're warm.
+///   2. Add up the steps into pen positions. That's a prefix sum, which SSE does 4 glyphs at a 
+///      time: each vector gets added to itself shifted by 1 and then by 2 lanes, and then the total 
+///      of everything before it.
+///   3. Break the lines (greedily, at spaces, or anywhere if a single word doesn't fit), and move 
+///      every line back to `x = 0` by subtracting where it starts, again 4 glyphs at a time.
+///
+/// The results of a whole batch of strings go into flat arrays that keep their capacity from 
+/// one batch to the next, so laying out the same amount of text every frame doesn't allocate.
+
+#define FONT_REPLACEMENT_CHARACTER 0xFFFD
+
+struct FontLayoutFont {
+  FontGlyphMap* glyph_map; 
+  FontKernIndex* kern_index; 
+
+  float scale;       // From `stbtt_ScaleForPixelHeight`
+  float ascent;      // Scaled
+  float line_height; // Scaled ascent - descent + line gap
+};
+
+static void font_layout_font_init(FontLayoutFont* layout_font, const stbtt_fontinfo* info, FontGlyphMap* glyph_map, FontKernIndex* kern_index, float pixel_height) {
+  int ascent, descent, line_gap;
+  stbtt_GetFontVMetrics(info, &ascent, &descent, &line_gap);
+
+  layout_font->glyph_map   = glyph_map;
+  layout_font->kern_index  = kern_index;
+  layout_font->scale       = stbtt_ScaleForPixelHeight(info, pixel_height);
+  layout_font->ascent      = ascent * layout_font->scale;
+  layout_font->line_height = (ascent - descent + line_gap) * layout_font->scale;
+}
+
+/// One laid out string. Its glyphs are `[first_glyph, first_glyph + glyphs_count)` in the arrays 
+/// of `FontLayoutBatch`. The box starts at `(0, 0)` (the top of the first line) and is `width` by 
+/// `height` pixels.
+
+struct FontLayoutResult {
+  size_t first_glyph; 
+  size_t glyphs_count; 
+  int lines_count;
+
+  float width; 
+  float height;
+};
+
+struct FontLayoutBatch {
+  /// One element per glyph of every string, in order. `xs` and `ys` are the pen position of the 
+  /// glyph: `ys` is the baseline of its line.
+  std::vector<int> glyph_indices; 
+  std::vector<float> xs; 
+  std::vector<float> ys; 
+
+  std::vector<FontLayoutResult> results; // One per string
+
+  std::vector<int> codepoints; // Scratch space for the string being laid out
+};
+
+/// Decodes one UTF-8 character at `text[*index]`, and moves `*index` past it. Malformed bytes 
+/// come out as U+FFFD, one byte at a time.
+
+static int font_utf8_decode(const unsigned char* text, size_t length, size_t* index) {
+  unsigned char lead = text[(*index)++];
+  if(lead < 0x80) {
+    return lead;
+  }
+
+  int extra = lead >= 0xF0 ? 3 : (lead >= 0xE0 ? 2 : (lead >= 0xC0 ? 1 : -1));
+  if(extra < 0 || lead >= 0xF8 || *index + extra > length) {
+    return FONT_REPLACEMENT_CHARACTER;
+  }
+
+  int codepoint = lead & (0x3F >> extra);
+
+  for(int i = 0; i < extra; i++) {
+    unsigned char next = text[*index + i];
+    if((next & 0xC0) != 0x80) {
+      return FONT_REPLACEMENT_CHARACTER;
+    }
+
+    codepoint = (codepoint << 6) | (next & 0x3F);
+  }
+
+  *index += extra;
+  return codepoint;
+}
+
+/// Pass 2. Turns the `steps` between glyphs into the pen position of each glyph, in place.
+
+static void font_prefix_sum(float* steps, size_t count) {
+  size_t i    = 0;
+  float total = 0.0f;
+
+#if defined(FONT_HAS_SSE2)
+  __m128 carry = _mm_setzero_ps();
+
+  for(; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(steps + i);
+    x        = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+    x        = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+    x        = _mm_add_ps(x, carry);
+
+    _mm_storeu_ps(steps + i, x);
+    carry = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+
+  total = _mm_cvtss_f32(carry);
+#endif
+
+  // Whatever is left over (or everything, without SSE2).
+  for(; i < count; i++) {
+    total   += steps[i];
+    steps[i] = total;
+  }
+}
+
+/// Pass 3, for one line. Moves `xs[first, last)` left by `line_start`, and sets their `ys` to `baseline`.
+
+static void font_place_line(float* xs, float* ys, size_t first, size_t last, float line_start, float baseline) {
+  size_t i = first;
+
+#if defined(FONT_HAS_SSE2)
+  const __m128 start_v    = _mm_set1_ps(line_start);
+  const __m128 baseline_v = _mm_set1_ps(baseline);
+
+  for(; i + 4 <= last; i += 4) {
+    _mm_storeu_ps(xs + i, _mm_sub_ps(_mm_loadu_ps(xs + i), start_v));
+    _mm_storeu_ps(ys + i, baseline_v);
+  }
+#endif
+
+  for(; i < last; i++) {
+    xs[i] -= line_start;
+    ys[i]  = baseline;
+  }
+}
+
+/// Lays out `text` (`length` bytes of UTF-8) and appends it to `batch`. Lines are wrapped at 
+/// `max_width` pixels (pass 0 to never wrap), and `\n` always starts a new line.
+
+static void font_layout_text(FontLayoutBatch* batch, const FontLayoutFont* font, const char* text, size_t length, float max_width) {
+  /// Pass 1.
+
+  batch->codepoints.clear();
+  for(size_t index = 0; index < length; ) {
+    batch->codepoints.push_back(font_utf8_decode((const unsigned char*)text, length, &index));
+  }
+
+  FontLayoutResult result = {};
+  result.first_glyph      = batch->glyph_indices.size();
+  result.glyphs_count     = batch->codepoints.size();
+
+  size_t first = result.first_glyph;
+  size_t count = result.glyphs_count;
+
+  batch->glyph_indices.resize(first + count);
+  batch->xs.resize(first + count);
+  batch->ys.resize(first + count);
+
+  int* glyphs                  = batch->glyph_indices.data() + first;
+  float* pens                  = batch->xs.data() + first; // The steps, and then the pen position of each glyph
+  std::vector<float>& advances = batch->ys;                // The `ys` get overwritten in pass 3, so they can hold the advances
+  int previous_glyph           = 0;
+  int previous_advance         = 0;
+
+  for(size_t i = 0; i < count; i++) {
+    FontGlyphMapEntry entry = font_glyph_map_get(font->glyph_map, batch->codepoints[i]);
+
+    // The kerning between two glyphs moves the second one, so it goes into the second one's step.
+    int step = previous_advance;
+    if(previous_glyph != 0 && entry.glyph_index != 0) {
+      step += font_kern_index_get(font->kern_index, previous_glyph, entry.glyph_index);
+    }
+
+    glyphs[i]           = entry.glyph_index;
+    pens[i]             = step * font->scale;
+    advances[first + i] = entry.advance * font->scale;
+    previous_glyph      = entry.glyph_index;
+    previous_advance    = entry.advance;
+  }
+
+  /// Pass 2. The first glyph's step is 0, so the prefix sum is the pen position of every glyph.
+
+  font_prefix_sum(pens, count);
+
+  /// Pass 3. `line_first` is the first glyph of the current line, and `break_at` the last space 
+  /// on it (where we'd rather break, if we have to).
+
+  size_t line_first = 0;
+  size_t break_at   = count; // None yet
+  float line_start  = 0.0f;
+
+  auto end_line = [&](size_t next_first, float line_end) {
+    float baseline = font->ascent + result.lines_count * font->line_height;
+    font_place_line(batch->xs.data() + first, batch->ys.data() + first, line_first, next_first, line_start, baseline);
+
+    result.width = line_end - line_start > result.width ? line_end - line_start : result.width;
+    result.lines_count++;
+
+    line_first = next_first;
+    line_start = next_first < count ? pens[next_first] : 0.0f;
+    break_at   = count;
+  };
+
+  for(size_t i = 0; i < count; i++) {
+    int codepoint = batch->codepoints[i];
+    float right   = pens[i] + advances[first + i];
+
+    if(codepoint == '\n') {
+      end_line(i + 1, pens[i]);
+      continue;
+    }
+
+    if(max_width > 0.0f && right - line_start > max_width && i > line_first && codepoint != ' ') {
+      if(break_at < count) {
+        end_line(break_at + 1, pens[break_at]); // The space itself hangs off the end of the line
+      }
+      else {
+        end_line(i, pens[i]);
+      }
+    }
+
+    if(codepoint == ' ') {
+      break_at = i;
+    }
+  }
+
+  // The last line. A string that is empty, or ends with a `\n`, ends with an empty line.
+  if(line_first < count) {
+    end_line(count, pens[count - 1] + advances[first + count - 1]);
+  }
+  else if(count == 0 || batch->codepoints[count - 1] == '\n') {
+    end_line(count, line_start);
+  }
+
+  result.height = result.lines_count * font->line_height;
+  batch->results.push_back(result);
+}
+
+/// Lays out a whole batch of strings, replacing whatever was in `batch` before (but keeping its memory).
+
+static void font_layout_batch(FontLayoutBatch* batch, const FontLayoutFont* font, const char* const* texts, const size_t* lengths, 
+                              size_t texts_count, float max_width) {
+  batch->glyph_indices.clear();
+  batch->xs.clear();
+  batch->ys.clear();
+  batch->results.clear();
+
+  for(size_t i = 0; i < texts_count; i++) {
+    font_layout_text(batch, font, texts[i], lengths[i], max_width);
+  }
+}
 
 int main() {
   /// In order to load a font with stb_truetype, we will first have to 
@@ -17,16 +1344,22 @@ int main() {
   /// variable of type `stbtt_fontinfo`. This structure will contain all the 
   /// relevant information about the font (as implied by the name). 
   ///
-  /// Just make sure that the buffer you give to STB is actually valid. You 
-  /// can free it after the load function has returned. The `stbtt_InitFont` 
-  /// function will return `0` if it fails to load the font, and `1` if successful.
+  /// Just make sure that the buffer you give to STB is actually valid. stb_truetype 
+  /// does not copy it, so it has to stay alive for as long as you use the `info`. The 
+  /// `stbtt_InitFont` function will return `0` if it fails to load the font, and `1` if successful.
   ///
   /// Sadly, as far as I know stb_truetype does not include any API that takes a 
-  /// file path and does the heavy-lifting for you. But, thankfully, reading 
-  /// binary data from a file is simple enough. 
+  /// file path and does the heavy-lifting for you. But, thankfully, we don't even have 
+  /// to read the file. The font registry above memory-maps it (and sets up every face 
+  /// in it while it's at it), so we just borrow its mapping and its faces here.
 
-  stbtt_fontinfo info;
-  unsigned char* font_data = read_file_in_bytes("path/to/font.ttf"); 
+  FontRegistry font_registry;
+  if(font_registry_add(&font_registry, "path/to/font.ttf") == 0) {
+    printf("ERROR: Could not map the font file!\n");
+    return -1;
+  }
+
+  const unsigned char* font_data = font_registry.files[0].data; 
 
   /// The three parameters of the `stbtt_InitFont` are pretty simple to understand. 
   /// 
@@ -55,15 +1388,21 @@ int main() {
   /// number of fonts in a given font. 
   ///
   /// Once again, though, for most `.ttf` files, `0` is usually the valid offset.
+  ///
+  /// The registry already called `stbtt_InitFont` on every face of the file (with the offset from 
+  /// `stbtt_GetFontOffsetForIndex`) when we added it, so instead of initializing face 0 a second 
+  /// time, we just ask the registry for it. If the face failed to initialize, it isn't there.
 
   int num_fonts = stbtt_GetNumberOfFonts(font_data); 
-  int offset    = stbtt_GetFontOffsetForIndex(font_data, 0);
 
-  if(stbtt_InitFont(&info, font_data, offset) == 0) {
+  const stbtt_fontinfo* face = font_registry_find(&font_registry, "path/to/font.ttf", 0);
+  if(!face) {
     printf("ERROR: Could not initialize STB truetype library!\n"); // Always check for errors!
     return -1;
   }
 
+  const stbtt_fontinfo& info = *face;
+
   /// The `stbtt_ScaleForPixelHeight` function will return a scaling factor 
   /// that can be applied to any value that comes out of stb_truetype going forward. 
   ///
@@ -273,7 +1612,7 @@ int main() {
   /// which takes in the actual codepoint values instead of a set of indices.
 
   int next_glyph_index = stbtt_FindGlyphIndex(&info, 's');
-  stbtt_GetGlyphKernAdvance(&info, glyph_index, next_glyph_index);
+  int kern = stbtt_GetGlyphKernAdvance(&info, glyph_index, next_glyph_index);
 
   /// Once again, the kern is returned as in unscaled coordinates so we have 
   /// to bring it to scaled coordinates. 
@@ -302,11 +1641,13 @@ int main() {
   /// function with the length of the kerning table that you retrieved.
   ///
   /// This is much more practical than querying the font every frame about the kern between two glyphs. 
+  /// The `font_kern_index_build` function above does exactly this, and turns the table into a hash 
+  /// table that layout code can query instead of `stbtt_GetGlyphKernAdvance`.
 
   int kern_table_length = stbtt_GetKerningTableLength(&info);
 
   stbtt_kerningentry* kern_table = (stbtt_kerningentry*)malloc(sizeof(stbtt_kerningentry) * kern_table_length);
-  stbtt_GetKerningTable(&info, kern_table);
+  stbtt_GetKerningTable(&info, kern_table, kern_table_length);
 
   /// Since stb_truetype allocates the bitmap internally, we'll need to de-allocate 
   /// the bitmap as well using the function below. 
@@ -315,4 +1656,495 @@ int main() {
   /// if you inserted any. We can leave that as null, though.
 
   stbtt_FreeBitmap(glyph_bitmap, nullptr);
+
+  /// Now, the packed atlas from above. We pack the printable ASCII and Latin-1 ranges at a couple 
+  /// of sizes (the small ones with 2x horizontal oversampling) into one 1024x1024 atlas: first with 
+  /// plain `stbtt_PackFontRanges` on one thread, then with `font_atlas_build` on 1 up to as many 
+  /// threads as the machine has. 
+  ///
+  /// For reference, we also time rasterizing the same glyphs one by one with `stbtt_GetGlyphBitmap`, 
+  /// like we did at the start.
+
+  const FontAtlasRange atlas_ranges[] = {
+    {32,  95, 16.0f, 2, 1, 0}, // Printable ASCII
+    {160, 96, 16.0f, 2, 1, 0}, // Latin-1
+    {32,  95, 24.0f, 2, 1, 0},
+    {160, 96, 24.0f, 2, 1, 0},
+    {32,  95, 48.0f, 1, 1, 0},
+    {160, 96, 48.0f, 1, 1, 0},
+  };
+  const size_t atlas_ranges_count = sizeof(atlas_ranges) / sizeof(atlas_ranges[0]);
+  const int atlas_size            = 1024;
+
+  auto atlas_start = std::chrono::steady_clock::now();
+  for(const FontAtlasRange& range : atlas_ranges) {
+    float range_scale = stbtt_ScaleForPixelHeight(&info, range.font_size);
+
+    for(int codepoint = range.first_codepoint; codepoint < range.first_codepoint + range.codepoints_count; codepoint++) {
+      int w, h, x, y;
+      stbtt_FreeBitmap(stbtt_GetGlyphBitmap(&info, range_scale, range_scale, stbtt_FindGlyphIndex(&info, codepoint), &w, &h, &x, &y), nullptr);
+    }
+  }
+  double per_glyph_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - atlas_start).count();
+  printf("ATLAS (per-glyph bitmaps): %.2f ms\n", per_glyph_ms);
+
+  {
+    std::vector<unsigned char> pixels((size_t)atlas_size * atlas_size);
+    std::vector<stbtt_packedchar> chars(atlas_ranges_count * 96);
+    std::vector<stbtt_pack_range> pack_ranges(atlas_ranges_count);
+
+    // With `stbtt_PackFontRanges`, the oversampling is per call, so it takes one call per setting.
+    atlas_start = std::chrono::steady_clock::now();
+
+    stbtt_pack_context context;
+    stbtt_PackBegin(&context, pixels.data(), atlas_size, atlas_size, 0, 1, nullptr);
+
+    for(size_t i = 0; i < atlas_ranges_count; i++) {
+      pack_ranges[i]                                  = stbtt_pack_range{};
+      pack_ranges[i].font_size                        = atlas_ranges[i].font_size;
+      pack_ranges[i].first_unicode_codepoint_in_range = atlas_ranges[i].first_codepoint;
+      pack_ranges[i].num_chars                        = atlas_ranges[i].codepoints_count;
+      pack_ranges[i].chardata_for_range               = chars.data() + i * 96;
+
+      stbtt_PackSetOversampling(&context, atlas_ranges[i].h_oversample, atlas_ranges[i].v_oversample);
+      stbtt_PackFontRanges(&context, font_data, 0, &pack_ranges[i], 1);
+    }
+
+    stbtt_PackEnd(&context);
+
+    double pack_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - atlas_start).count();
+    printf("ATLAS (stbtt_PackFontRanges): %.2f ms\n", pack_ms);
+  }
+
+  unsigned int max_threads = std::thread::hardware_concurrency();
+  max_threads              = max_threads == 0 ? 1 : max_threads;
+
+  for(unsigned int threads_count = 1; threads_count <= max_threads; threads_count++) {
+    FontAtlas atlas;
+
+    atlas_start = std::chrono::steady_clock::now();
+    font_atlas_build(&atlas, &info, atlas_ranges, atlas_ranges_count, atlas_size, atlas_size, 1, threads_count);
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - atlas_start).count();
+
+    printf("ATLAS (%2u threads): %.2f ms, %.1f%% filled, %i glyphs missing\n", 
+           threads_count, elapsed_ms, atlas.fill_ratio * 100.0f, atlas.missing_count);
+
+    // Drawing a glyph is then a lookup and a `stbtt_GetPackedQuad` away.
+    const stbtt_packedchar* packed = font_atlas_find(&atlas, 'A', 24.0f);
+    if(packed) {
+      float pen_x = 0.0f, pen_y = 0.0f;
+      stbtt_aligned_quad quad;
+      stbtt_GetPackedQuad(packed, atlas.width, atlas.height, 0, &pen_x, &pen_y, &quad, 0);
+    }
+
+    free(atlas.pixels);
+  }
+
+  /// Now, the glyph cache. We pretend to draw a page of CJK-like text every frame: 400 glyphs picked 
+  /// out of up to 3000 different ones (with some glyphs much more common than others, like in real 
+  /// text), at two sizes. First by rasterizing every glyph every frame, then through a cache with 
+  /// a 16MB budget. After the first few frames, the cache should hardly ever rasterize anything.
+
+  const int cache_frames           = 200;
+  const int cache_glyphs_per_frame = 400;
+  const int cache_distinct_glyphs  = info.numGlyphs - 1 < 3000 ? info.numGlyphs - 1 : 3000;
+  const float cache_scales[]       = {stbtt_ScaleForPixelHeight(&info, 16.0f), stbtt_ScaleForPixelHeight(&info, 32.0f)};
+
+  // The glyphs of every frame, generated up front so both runs draw the exact same thing.
+  std::vector<int> cache_glyphs((size_t)cache_frames * cache_glyphs_per_frame);
+  unsigned int random_state = 12345;
+
+  for(int& glyph : cache_glyphs) {
+    random_state     = random_state * 1664525u + 1013904223u;
+    float uniform    = (random_state >> 8) / 16777216.0f;
+    glyph            = 1 + (int)(uniform * uniform * uniform * cache_distinct_glyphs); // Skewed towards the first glyphs
+  }
+
+  auto cache_start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < cache_glyphs.size(); i++) {
+    int w, h, x, y;
+    float glyph_scale = cache_scales[i % 2];
+
+    stbtt_FreeBitmap(stbtt_GetGlyphBitmap(&info, glyph_scale, glyph_scale, cache_glyphs[i], &w, &h, &x, &y), nullptr);
+  }
+  double uncached_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cache_start).count();
+
+  FontGlyphCache glyph_cache;
+  font_glyph_cache_init(&glyph_cache, 16 * 1024 * 1024, 8192);
+
+  size_t warm_misses = 0;
+
+  cache_start = std::chrono::steady_clock::now();
+  for(int frame = 0; frame < cache_frames; frame++) {
+    font_glyph_cache_begin_frame(&glyph_cache);
+    size_t misses_before = glyph_cache.misses;
+
+    for(int i = 0; i < cache_glyphs_per_frame; i++) {
+      size_t index = (size_t)frame * cache_glyphs_per_frame + i;
+
+      FontCachedGlyph glyph;
+      font_glyph_cache_get(&glyph_cache, &info, cache_glyphs[index], cache_scales[index % 2], &glyph);
+
+      // ... Copy `glyph.pixels` into your texture here ...
+    }
+
+    if(frame >= cache_frames / 2) {
+      warm_misses += glyph_cache.misses - misses_before;
+    }
+  }
+  double cached_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cache_start).count();
+
+  printf("GLYPH CACHE: uncached = %.3f ms/frame, cached = %.3f ms/frame, %.1f%% hits, %zu rasterizations in the last %i frames, %zu evictions, %zu pages\n", 
+         uncached_ms / cache_frames, cached_ms / cache_frames, 100.0 * glyph_cache.hits / (glyph_cache.hits + glyph_cache.misses), 
+         warm_misses, cache_frames / 2, glyph_cache.evictions, glyph_cache.pages.size());
+
+  font_glyph_cache_shutdown(&glyph_cache);
+
+  /// Now, the kerning index. We lay out a long paragraph (about 64KB of English-looking text) one 
+  /// line after the other, once with `stbtt_GetGlyphKernAdvance` and once with the index. Everything 
+  /// else in the loop is the same, so the difference is all kerning. The two runs should end at the 
+  /// exact same pen position.
+
+  std::string paragraph;
+  const char* words[] = {"Typography ", "AVAILABLE ", "kerning ", "To ", "We ", "Yo, ", "waves ", "offline ", "LT ", "P. ", "fjord "};
+  for(size_t i = 0; paragraph.size() < 64 * 1024; i++) {
+    paragraph += words[(i * 7 + i / 3) % (sizeof(words) / sizeof(words[0]))];
+  }
+
+  FontKernIndex kern_index;
+  font_kern_index_build(&kern_index, &info);
+
+  for(int use_index = 0; use_index < 2; use_index++) {
+    long long pen_x      = 0;
+    int previous_glyph   = 0;
+    const int iterations = 20;
+
+    auto layout_start = std::chrono::steady_clock::now();
+    for(int it = 0; it < iterations; it++) {
+      for(char c : paragraph) {
+        int glyph = stbtt_FindGlyphIndex(&info, (unsigned char)c);
+
+        int glyph_advance, bearing;
+        stbtt_GetGlyphHMetrics(&info, glyph, &glyph_advance, &bearing);
+
+        if(previous_glyph != 0) {
+          pen_x += use_index ? font_kern_index_get(&kern_index, previous_glyph, glyph) : stbtt_GetGlyphKernAdvance(&info, previous_glyph, glyph);
+        }
+
+        pen_x         += glyph_advance;
+        previous_glyph = glyph;
+      }
+    }
+    double layout_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - layout_start).count();
+
+    printf("KERNING (%s): %.1f MB/s of text, final pen position = %lld (%zu pairs indexed%s)\n", 
+           use_index ? "index" : "stbtt_GetGlyphKernAdvance", paragraph.size() * iterations / 1e6 / layout_seconds, pen_x, 
+           kern_index.count, kern_index.is_lazy ? ", lazily" : "");
+  }
+
+  /// Then, the glyph map. We go through the same paragraph as before, and get the glyph and advance 
+  /// of every character: first with `stbtt_FindGlyphIndex` and `stbtt_GetGlyphHMetrics`, then with 
+  /// the map. The totals should match. 
+  ///
+  /// The map is prefilled with ASCII and Latin-1 (one page), which is everything the paragraph 
+  /// uses. After that, lookups only read the map, so it could be shared between threads as-is.
+
+  FontGlyphMap glyph_map;
+  font_glyph_map_init(&glyph_map, &info);
+  font_glyph_map_prefill(&glyph_map, 0x00, 0xFF);
+
+  for(int use_map = 0; use_map < 2; use_map++) {
+    long long total_advance = 0;
+    const int iterations    = 20;
+
+    auto map_start = std::chrono::steady_clock::now();
+    for(int it = 0; it < iterations; it++) {
+      for(char c : paragraph) {
+        if(use_map) {
+          total_advance += font_glyph_map_get(&glyph_map, (unsigned char)c).advance;
+          continue;
+        }
+
+        int glyph_advance, bearing;
+        stbtt_GetGlyphHMetrics(&info, stbtt_FindGlyphIndex(&info, (unsigned char)c), &glyph_advance, &bearing);
+        total_advance += glyph_advance;
+      }
+    }
+    double map_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - map_start).count();
+
+    printf("GLYPH MAP (%s): %.1f M characters/s, total advance = %lld\n", 
+           use_map ? "map" : "stbtt_FindGlyphIndex", paragraph.size() * iterations / 1e6 / map_seconds, total_advance);
+  }
+
+  font_glyph_map_shutdown(&glyph_map);
+
+  /// Then, the SDF atlas. We build one atlas of printable ASCII, Latin-1, and the first 
+  /// thousand CJK ideographs (skipping the ones this font doesn't have) at 48 pixels, on 1 thread 
+  /// and on all of them. 
+  ///
+  /// For comparison, we rasterize the same glyphs as plain bitmaps at 4 sizes, since that's what it 
+  /// takes to cover 4 sizes without SDFs. Both are in milliseconds per 1000 glyphs.
+
+  std::vector<int> sdf_codepoints;
+  for(int codepoint = 32; codepoint < 256; codepoint++) {
+    if(codepoint < 127 || codepoint >= 160) {
+      sdf_codepoints.push_back(codepoint);
+    }
+  }
+  for(int codepoint = 0x4E00; codepoint < 0x4E00 + 1000; codepoint++) {
+    if(stbtt_FindGlyphIndex(&info, codepoint) != 0) {
+      sdf_codepoints.push_back(codepoint);
+    }
+  }
+
+  const double sdf_kilo_glyphs = sdf_codepoints.size() / 1000.0;
+
+  auto sdf_start = std::chrono::steady_clock::now();
+  for(float size : {16.0f, 24.0f, 32.0f, 48.0f}) {
+    float size_scale = stbtt_ScaleForPixelHeight(&info, size);
+
+    for(int codepoint : sdf_codepoints) {
+      int w, h, x, y;
+      stbtt_FreeBitmap(stbtt_GetGlyphBitmap(&info, size_scale, size_scale, stbtt_FindGlyphIndex(&info, codepoint), &w, &h, &x, &y), nullptr);
+    }
+  }
+  double bitmaps_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sdf_start).count();
+  printf("SDF (bitmaps at 4 sizes): %.2f ms per 1k glyphs\n", bitmaps_ms / sdf_kilo_glyphs);
+
+  for(unsigned int threads_count : {1u, max_threads}) {
+    FontSdfAtlas sdf_atlas;
+
+    sdf_start = std::chrono::steady_clock::now();
+    bool is_built = font_sdf_atlas_build(&sdf_atlas, &info, sdf_codepoints.data(), sdf_codepoints.size(), 48.0f, 8, 2048, 2048, threads_count);
+    double sdf_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sdf_start).count();
+
+    if(!is_built) {
+      printf("Failed to build the SDF atlas!\n");
+      break;
+    }
+
+    printf("SDF (atlas, %2u threads): %.2f ms per 1k glyphs, %i glyphs missing\n", threads_count, sdf_ms / sdf_kilo_glyphs, sdf_atlas.missing_count);
+
+    // Each glyph's metrics are in `sdf_atlas.glyphs`, in the same order as `sdf_codepoints`.
+    free(sdf_atlas.pixels);
+  }
+
+  /// Then, the layout engine. We make 20000 strings out of the words from the kerning 
+  /// benchmark (between 1 and 24 words each, like labels and table cells), and lay them all out 
+  /// at 16 pixels, wrapped at 300 pixels. First with the usual per-glyph stb_truetype calls, then 
+  /// with `font_layout_batch`. Both decode UTF-8 and break lines at the last space the same way, 
+  /// so they should end up with the same number of lines.
+
+  const int layout_strings_count = 20000;
+  std::vector<std::string> layout_strings(layout_strings_count);
+
+  for(int i = 0; i < layout_strings_count; i++) {
+    int words_count = 1 + (i * 7919) % 24;
+    for(int w = 0; w < words_count; w++) {
+      layout_strings[i] += words[(i + w * 3) % (sizeof(words) / sizeof(words[0]))];
+    }
+  }
+
+  std::vector<const char*> layout_texts; 
+  std::vector<size_t> layout_lengths;
+  for(const std::string& text : layout_strings) {
+    layout_texts.push_back(text.c_str());
+    layout_lengths.push_back(text.size());
+  }
+
+  const float layout_max_width = 300.0f;
+  float layout_scale           = stbtt_ScaleForPixelHeight(&info, 16.0f);
+
+  auto layout_start = std::chrono::steady_clock::now();
+  long long naive_lines = 0;
+
+  for(const std::string& text : layout_strings) {
+    const unsigned char* bytes = (const unsigned char*)text.c_str();
+
+    float pen = 0.0f, line_start = 0.0f, break_pen = 0.0f;
+    int lines = 0, previous_glyph = 0, codepoint = 0;
+    size_t glyphs_on_line = 0, glyphs_after_break = 0;
+    bool has_break = false, is_after_newline = false, is_after_space = false;
+
+    for(size_t index = 0; index < text.size(); ) {
+      codepoint = font_utf8_decode(bytes, text.size(), &index);
+      int glyph = stbtt_FindGlyphIndex(&info, codepoint);
+
+      int glyph_advance, bearing;
+      stbtt_GetGlyphHMetrics(&info, glyph, &glyph_advance, &bearing);
+
+      // The kerning with the previous glyph moves this one, so it goes before its advance.
+      int kern = previous_glyph != 0 && glyph != 0 ? stbtt_GetGlyphKernAdvance(&info, previous_glyph, glyph) : 0;
+
+      float left     = pen + kern * layout_scale;
+      pen            = left + glyph_advance * layout_scale;
+      previous_glyph = glyph;
+
+      // A new line (or the one after the last space) starts where the next glyph does.
+      if(is_after_newline) {
+        line_start       = left;
+        is_after_newline = false;
+      }
+
+      if(is_after_space) {
+        break_pen      = left;
+        is_after_space = false;
+      }
+
+      if(codepoint == '\n') {
+        lines++;
+        glyphs_on_line   = 0;
+        has_break        = false;
+        is_after_newline = true;
+        continue;
+      }
+
+      // Breaking at the last space on the line, or right before this glyph if there is none.
+      if(pen - line_start > layout_max_width && glyphs_on_line > 0 && codepoint != ' ') {
+        lines++;
+        line_start     = has_break ? break_pen : left;
+        glyphs_on_line = has_break ? glyphs_after_break : 0;
+        has_break      = false;
+      }
+
+      if(codepoint == ' ') {
+        has_break          = true;
+        is_after_space     = true;
+        glyphs_after_break = 0;
+      }
+      else {
+        glyphs_after_break++;
+      }
+
+      glyphs_on_line++;
+    }
+
+    // The last line. A string that is empty, or ends with a `\n`, ends with an empty line.
+    if(glyphs_on_line > 0 || text.empty() || codepoint == '\n') {
+      lines++;
+    }
+
+    naive_lines += lines;
+  }
+
+  double naive_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - layout_start).count();
+
+  FontGlyphMap layout_map;
+  font_glyph_map_init(&layout_map, &info);
+
+  FontLayoutFont layout_font;
+  font_layout_font_init(&layout_font, &info, &layout_map, &kern_index, 16.0f);
+
+  FontLayoutBatch layout_batch;
+  font_layout_batch(&layout_batch, &layout_font, layout_texts.data(), layout_lengths.data(), layout_texts.size(), layout_max_width); // Warming up the map and the batch
+
+  const int layout_frames = 10;
+
+  layout_start = std::chrono::steady_clock::now();
+  for(int frame = 0; frame < layout_frames; frame++) {
+    font_layout_batch(&layout_batch, &layout_font, layout_texts.data(), layout_lengths.data(), layout_texts.size(), layout_max_width);
+  }
+  double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - layout_start).count() / layout_frames;
+
+  long long batch_lines = 0;
+  for(const FontLayoutResult& result : layout_batch.results) {
+    batch_lines += result.lines_count;
+  }
+
+  printf("LAYOUT (per-glyph stb_truetype): %.0f strings/s, %lld lines\n", layout_strings_count / naive_seconds, naive_lines);
+  printf("LAYOUT (batch): %.0f strings/s, %lld lines, %zu glyphs (%s)\n", layout_strings_count / batch_seconds, batch_lines, 
+         layout_batch.glyph_indices.size(), batch_lines == naive_lines ? "same lines" : "LINES DIFFER");
+
+  /// The line count doesn't tell whether every glyph ended up in the right place, though. So, we also 
+  /// lay out a string full of kerning pairs the way stb_truetype's documentation does it 
+  /// (`xpos += advance; xpos += kern`), and compare each glyph's position against the batch.
+
+  const char* kerning_text = "AVAWAY To. Wavy LTA";
+  size_t kerning_length    = strlen(kerning_text);
+
+  font_layout_batch(&layout_batch, &layout_font, &kerning_text, &kerning_length, 1, 0.0f);
+
+  float kerning_xpos       = 0.0f;
+  float kerning_difference = 0.0f;
+
+  for(size_t i = 0; i < kerning_length; i++) {
+    int glyph = stbtt_FindGlyphIndex(&info, kerning_text[i]);
+
+    float difference   = layout_batch.xs[i] > kerning_xpos ? layout_batch.xs[i] - kerning_xpos : kerning_xpos - layout_batch.xs[i];
+    kerning_difference = difference > kerning_difference ? difference : kerning_difference;
+
+    int glyph_advance, bearing;
+    stbtt_GetGlyphHMetrics(&info, glyph, &glyph_advance, &bearing);
+    kerning_xpos += glyph_advance * layout_scale;
+
+    if(i + 1 < kerning_length) {
+      kerning_xpos += stbtt_GetGlyphKernAdvance(&info, glyph, stbtt_FindGlyphIndex(&info, kerning_text[i + 1])) * layout_scale;
+    }
+  }
+
+  printf("LAYOUT (kerning): '%s', largest difference from stb_truetype = %f pixels\n", kerning_text, kerning_difference);
+
+  font_glyph_map_shutdown(&layout_map);
+
+  /// And, finally, the registry itself. We register a font collection (swap in any `.ttc` you have, 
+  /// like `NotoSansCJK-Regular.ttc` or macOS's `Helvetica.ttc`), and compare how long it takes to get 
+  /// every face ready against reading the whole file into the heap first. Registering the same file 
+  /// again is free, and every face shares the one mapping. 
+  ///
+  /// Whichever pass runs first pulls the file into the OS's page cache for the other one. So, both 
+  /// passes run several times, taking turns going first, and we keep the best time of each.
+
+  const char* collection_path = "path/to/collection.ttc";
+  const int registry_rounds   = 6;
+
+  double read_ms = 1e9, map_ms = 1e9;
+  int faces_count = 0;
+
+  for(int round = 0; round < registry_rounds; round++) {
+    for(int pass = 0; pass < 2; pass++) {
+      bool is_read_pass = (pass + round) % 2 == 0;
+      auto registry_start = std::chrono::steady_clock::now();
+
+      if(is_read_pass) {
+        FILE* file = fopen(collection_path, "rb");
+        if(file) {
+          fseek(file, 0, SEEK_END);
+          long file_size = ftell(file);
+          fseek(file, 0, SEEK_SET);
+
+          std::vector<unsigned char> file_data((size_t)file_size);
+          size_t read_size = fread(file_data.data(), 1, file_data.size(), file);
+          fclose(file);
+
+          int read_faces = read_size == file_data.size() ? stbtt_GetNumberOfFonts(file_data.data()) : 0;
+          for(int i = 0; i < read_faces; i++) {
+            stbtt_fontinfo read_face = {};
+            stbtt_InitFont(&read_face, file_data.data(), stbtt_GetFontOffsetForIndex(file_data.data(), i));
+          }
+        }
+      }
+      else {
+        FontRegistry round_registry;
+        faces_count = font_registry_add(&round_registry, collection_path);
+        font_registry_shutdown(&round_registry);
+      }
+
+      double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - registry_start).count();
+      double& best_ms   = is_read_pass ? read_ms : map_ms;
+      best_ms           = elapsed_ms < best_ms ? elapsed_ms : best_ms;
+    }
+  }
+
+  font_registry_add(&font_registry, collection_path);
+  font_registry_add(&font_registry, collection_path); // Already registered, so nothing happens
+
+  printf("REGISTRY: %i faces, read into the heap = %.3f ms, mapped = %.3f ms (best of %i), %zu files and %zu faces registered\n", 
+         faces_count, read_ms, map_ms, registry_rounds, font_registry.files.size(), font_registry.faces.size());
+
+  const stbtt_fontinfo* second_face = font_registry_find(&font_registry, collection_path, 1);
+  if(second_face) {
+    printf("REGISTRY: face 1 has %i glyphs\n", second_face->numGlyphs);
+  }
+
+  font_registry_shutdown(&font_registry);
 }
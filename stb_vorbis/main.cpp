@@ -3,11 +3,866 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <functional>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 /// You can find the stb_vorbis library at the link below: 
 ///
 /// https://github.com/nothings/stb
 
+/// `stb_vorbis_decode_filename` decodes the whole file into one big buffer. That's great for 
+/// short sounds, but a long music track would take tens of megabytes. Instead, stb_vorbis 
+/// has a "pushdata" API, where _we_ hand it the compressed bytes a chunk at a time and it 
+/// hands us back one decoded frame at a time. With that, the memory of a stream stays 
+/// the same no matter how long the file is.
+///
+/// The bytes can come from anywhere. A file on disk, a memory-mapped file, or an entry 
+/// inside a packed archive. To not care where, we read them through a small "byte source". 
+/// The `peek` function returns a pointer to (up to) `size` bytes starting at `offset` and 
+/// writes how many bytes are actually there into `out_size`. 
+///
+/// Since the source returns a _pointer_, sources that already have the bytes in memory 
+/// (mmap, archives) can just point into their memory without copying anything. Only the 
+/// file source has to read the bytes into a buffer of its own first.
+
+struct VorbisByteSource {
+  void* user_data; 
+  const unsigned char* (*peek)(void* user_data, size_t offset, size_t size, size_t* out_size);
+};
+
+/// The most bytes we'll ever hand to stb_vorbis at once. An Ogg page is at most ~64KB, and 
+/// the header pages can get close to that, so this leaves some room. 
+
+#define VORBIS_STREAM_MAX_INPUT (128 * 1024)
+
+/// A byte source over memory. Use this for memory-mapped files or for an entry inside a 
+/// packed archive (`data` would just point to the start of the entry).
+
+struct VorbisMemorySource {
+  const unsigned char* data; 
+  size_t size;
+};
+
+static const unsigned char* vorbis_memory_source_peek(void* user_data, size_t offset, size_t size, size_t* out_size) {
+  VorbisMemorySource* source = (VorbisMemorySource*)user_data;
+
+  if(offset >= source->size) {
+    *out_size = 0;
+    return nullptr;
+  }
+
+  *out_size = (source->size - offset) < size ? (source->size - offset) : size;
+  return source->data + offset;
+}
+
+/// A byte source over a regular file. It keeps a window of the file in `buffer` and only 
+/// reads from the disk again when asked for bytes outside of that window.
+
+struct VorbisFileSource {
+  FILE* file;
+
+  size_t buffer_offset; // Where in the file the buffer starts
+  size_t buffer_size;   // How many bytes of the buffer are valid
+  bool is_end_of_file;  // Whether the last read came up short, so the buffer runs to the end of the file
+  unsigned char buffer[VORBIS_STREAM_MAX_INPUT];
+};
+
+static const unsigned char* vorbis_file_source_peek(void* user_data, size_t offset, size_t size, size_t* out_size) {
+  VorbisFileSource* source = (VorbisFileSource*)user_data;
+
+  // If the last read came up short, we hit the end of the file, so whatever the buffer has is all there is. 
+  // A fresh source hasn't read anything yet, so it always reads first.
+  size_t buffer_end = source->buffer_offset + source->buffer_size;
+  bool is_in_buffer = source->buffer_size > 0 && offset >= source->buffer_offset && offset <= buffer_end && 
+                      (offset + size <= buffer_end || source->is_end_of_file);
+
+  if(!is_in_buffer) {
+    fseek(source->file, (long)offset, SEEK_SET);
+
+    source->buffer_offset  = offset;
+    source->buffer_size    = fread(source->buffer, 1, VORBIS_STREAM_MAX_INPUT, source->file);
+    source->is_end_of_file = source->buffer_size < VORBIS_STREAM_MAX_INPUT;
+    buffer_end             = offset + source->buffer_size;
+  }
+
+  *out_size = (buffer_end - offset) < size ? (buffer_end - offset) : size;
+  return source->buffer + (offset - source->buffer_offset);
+}
+
+/// The ring buffer we decode into. Much like with the byte sources, it's a fixed size. It must be 
+/// able to hold at least one full decoded frame (`stb_vorbis_info.max_frame_size` times the channels). 
+/// The size must be a power of two.
+///
+/// Only one thread should call `vorbis_stream_fill` (the decoder) and only one thread should call 
+/// `vorbis_stream_read` (the audio callback), but those can be two _different_ threads. The two 
+/// positions are atomic for exactly that reason.
+
+#define VORBIS_STREAM_RING_SAMPLES 16384
+
+struct VorbisStream {
+  VorbisByteSource source; 
+  size_t source_offset; // The next byte stb_vorbis hasn't consumed yet
+  size_t audio_offset;  // Where the first audio page starts (right after the headers)
+  size_t window_size;   // How many bytes we offer stb_vorbis at a time
+
+  stb_vorbis* vorbis;
+  stb_vorbis_info info;
+  std::atomic<bool> reached_end;
+
+  float ring[VORBIS_STREAM_RING_SAMPLES];
+  std::atomic<size_t> write_pos; 
+  std::atomic<size_t> read_pos;
+};
+
+/// Opens a stream over the given byte source. The `alloc` argument is the same as the one 
+/// for `stb_vorbis_open_filename`, and can be left as `nullptr`.
+
+static bool vorbis_stream_open(VorbisStream* stream, VorbisByteSource source, const stb_vorbis_alloc* alloc) {
+  stream->source        = source;
+  stream->source_offset = 0;
+  stream->window_size   = 4 * 1024;
+  stream->vorbis        = nullptr;
+  stream->reached_end.store(false);
+  stream->write_pos.store(0);
+  stream->read_pos.store(0);
+
+  /// `stb_vorbis_open_pushdata` needs all the headers of the file in the first block. If the 
+  /// block is too small, it fails with `VORBIS_need_more_data`, and we just try again with a 
+  /// bigger block. It tells us how many bytes the headers took through `bytes_used`.
+
+  while(!stream->vorbis) {
+    size_t available; 
+    const unsigned char* data = source.peek(source.user_data, 0, stream->window_size, &available);
+
+    int bytes_used = 0, error = 0;
+    stream->vorbis = stb_vorbis_open_pushdata(data, (int)available, &bytes_used, &error, alloc);
+
+    if(stream->vorbis) {
+      stream->source_offset = bytes_used;
+      stream->audio_offset  = bytes_used;
+      break;
+    }
+
+    if(error != VORBIS_need_more_data || available < stream->window_size || stream->window_size >= VORBIS_STREAM_MAX_INPUT) {
+      return false;
+    }
+
+    stream->window_size *= 2;
+  }
+
+  stream->info = stb_vorbis_get_info(stream->vorbis);
+
+  if((size_t)(stream->info.max_frame_size * stream->info.channels) > VORBIS_STREAM_RING_SAMPLES) {
+    stb_vorbis_close(stream->vorbis);
+    return false;
+  }
+
+  return true;
+}
+
+/// Decodes the next frame from the byte source. Returns `false` once the stream is over. The 
+/// decoded samples are written to `output`, one array per channel (`output[channel][sample]`). 
+/// A frame can have `0` samples (the very first frame, for example), which is not an error.
+
+static bool vorbis_stream_decode_frame(VorbisStream* stream, float*** output, int* samples) {
+  while(true) {
+    size_t available;
+    const unsigned char* data = stream->source.peek(stream->source.user_data, stream->source_offset, stream->window_size, &available);
+
+    int channels;
+    int bytes_used = stb_vorbis_decode_frame_pushdata(stream->vorbis, data, (int)available, &channels, output, samples);
+
+    /// Nothing was used and nothing was decoded. That means the block didn't contain a whole 
+    /// frame. If the source has more bytes, we offer a bigger block starting at the _same_ 
+    /// place. Otherwise, the stream is over.
+
+    if(bytes_used == 0 && *samples == 0) {
+      if(available < stream->window_size || stream->window_size >= VORBIS_STREAM_MAX_INPUT) {
+        return false;
+      }
+
+      stream->window_size *= 2;
+      continue;
+    }
+
+    stream->source_offset += bytes_used;
+    return true;
+  }
+}
+
+/// Copies `samples_count` samples of a decoded frame, starting at `first_sample`, into the ring buffer. 
+/// stb_vorbis gives us each channel in its own array, so we interleave them while copying.
+
+static void vorbis_stream_write_frame(VorbisStream* stream, float** output, int first_sample, int samples_count) {
+  int channels     = stream->info.channels;
+  size_t write_pos = stream->write_pos.load(std::memory_order_relaxed);
+
+  for(int i = 0; i < samples_count; i++) {
+    for(int ch = 0; ch < channels; ch++) {
+      stream->ring[(write_pos + i * channels + ch) & (VORBIS_STREAM_RING_SAMPLES - 1)] = output[ch][first_sample + i];
+    }
+  }
+
+  stream->write_pos.store(write_pos + samples_count * channels, std::memory_order_release);
+}
+
+/// Decodes frames into the ring buffer until it can't fit another full frame. Returns `false` once 
+/// the whole stream has been decoded. 
+
+static bool vorbis_stream_fill(VorbisStream* stream) {
+  size_t max_frame_samples = stream->info.max_frame_size * stream->info.channels;
+
+  while(!stream->reached_end.load(std::memory_order_relaxed)) {
+    size_t write_pos = stream->write_pos.load(std::memory_order_relaxed);
+    if(VORBIS_STREAM_RING_SAMPLES - (write_pos - stream->read_pos.load(std::memory_order_acquire)) < max_frame_samples) {
+      return true; // Full. Come back later.
+    }
+
+    float** output; 
+    int samples;
+
+    if(!vorbis_stream_decode_frame(stream, &output, &samples)) {
+      stream->reached_end.store(true, std::memory_order_release);
+      break;
+    }
+
+    vorbis_stream_write_frame(stream, output, 0, samples);
+  }
+
+  return false;
+}
+
+/// Copies up to `frames_count` interleaved frames out of the ring buffer into `out_samples`. 
+/// Returns the number of frames that were copied, which can be less than what was asked if 
+/// the decoder hasn't caught up (or the stream is over).
+
+static size_t vorbis_stream_read(VorbisStream* stream, float* out_samples, size_t frames_count) {
+  size_t channels  = stream->info.channels;
+  size_t read_pos  = stream->read_pos.load(std::memory_order_relaxed);
+  size_t available = (stream->write_pos.load(std::memory_order_acquire) - read_pos) / channels;
+
+  size_t frames_read = frames_count < available ? frames_count : available;
+  for(size_t i = 0; i < frames_read * channels; i++) {
+    out_samples[i] = stream->ring[(read_pos + i) & (VORBIS_STREAM_RING_SAMPLES - 1)];
+  }
+
+  stream->read_pos.store(read_pos + frames_read * channels, std::memory_order_release);
+  return frames_read;
+}
+
+static bool vorbis_stream_is_finished(VorbisStream* stream) {
+  return stream->reached_end.load(std::memory_order_acquire) && 
+         stream->read_pos.load(std::memory_order_relaxed) == stream->write_pos.load(std::memory_order_acquire);
+}
+
+static void vorbis_stream_close(VorbisStream* stream) {
+  stb_vorbis_close(stream->vorbis);
+}
+
+/// `stb_vorbis_seek` has to find the right spot in the file by bisecting through it, reading a 
+/// few pages at every step. That's fine once in a while, but when scrubbing or looping a long 
+/// track, those reads cause audible hitches. 
+///
+/// An OGG file is made out of "pages". Each page header has the position (in samples) of the 
+/// last sample that finishes on that page, called the "granule position". If we walk through 
+/// the file once and write down the byte offset and granule position of every page, seeking 
+/// becomes a binary search in memory, followed by a jump straight to the right page. 
+///
+/// That walk only reads the page headers, but it still touches the whole file, so we save the 
+/// index next to the asset (`audio.ogg` -> `audio.ogg.idx`) and only rebuild it when the file 
+/// changes. The sidecar is keyed by the size and modification time of the file, along with a hash 
+/// of its first and last 64KB.
+///
+/// To actually jump to a page, we use the pushdata stream from above. `stb_vorbis_flush_pushdata` 
+/// tells stb_vorbis that the next bytes we give it are not a continuation of the previous ones. 
+
+#define VORBIS_INDEX_VERSION   1
+#define VORBIS_INDEX_HASH_SIZE (64 * 1024)
+
+struct VorbisPageEntry {
+  unsigned long long byte_offset; 
+  unsigned long long granule_position;
+};
+
+struct VorbisIndexHeader {
+  char magic[4]; // Always "OGGI"
+  unsigned int version;
+
+  unsigned long long file_size; 
+  unsigned long long file_mtime; 
+  unsigned long long file_hash;
+
+  unsigned long long pages_count;
+};
+
+struct VorbisPageIndex {
+  std::vector<VorbisPageEntry> pages;
+};
+
+/// Walks through every page in the byte source and writes down the ones that have a granule position. 
+///
+/// Each page starts with a 27 byte header: the "OggS" capture pattern, a version, some flags, the 
+/// granule position (8 bytes, little-endian), the serial number of the stream, a sequence number, a 
+/// checksum, and the number of "segments". The segment table follows, one byte per segment, and the 
+/// page's data is just the sum of those bytes. 
+
+static void vorbis_index_build(VorbisByteSource source, VorbisPageIndex* index) {
+  index->pages.clear();
+
+  size_t offset = 0;
+  unsigned int first_serial = 0;
+
+  while(true) {
+    size_t available;
+    const unsigned char* header = source.peek(source.user_data, offset, 27 + 255, &available);
+
+    if(available < 27 || memcmp(header, "OggS", 4) != 0) {
+      break;
+    }
+
+    unsigned long long granule = 0;
+    for(int i = 7; i >= 0; i--) {
+      granule = (granule << 8) | header[6 + i];
+    }
+
+    unsigned int serial = header[14] | (header[15] << 8) | (header[16] << 16) | ((unsigned int)header[17] << 24);
+    int segments_count  = header[26];
+
+    if(available < (size_t)(27 + segments_count)) {
+      break;
+    }
+
+    size_t page_size = 27 + segments_count;
+    for(int i = 0; i < segments_count; i++) {
+      page_size += header[27 + i];
+    }
+
+    // A granule of -1 means no packet finishes on this page. We also skip pages of any other (chained) stream.
+    first_serial = offset == 0 ? serial : first_serial;
+
+    if(granule != ~0ull && serial == first_serial) {
+      index->pages.push_back({offset, granule});
+    }
+
+    offset += page_size;
+  }
+}
+
+/// A simple FNV-1a hash. It's not cryptographic in any way, but it's more than enough to notice a changed file.
+
+static unsigned long long vorbis_hash_bytes(unsigned long long hash, const unsigned char* bytes, size_t size) {
+  for(size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static bool vorbis_get_file_key(const char* path, VorbisIndexHeader* header) {
+  struct stat file_stat; 
+  if(stat(path, &file_stat) != 0) {
+    return false;
+  }
+
+  FILE* file = fopen(path, "rb");
+  if(!file) {
+    return false;
+  }
+
+  header->file_size  = (unsigned long long)file_stat.st_size;
+  header->file_mtime = (unsigned long long)file_stat.st_mtime;
+  header->file_hash  = 14695981039346656037ull;
+
+  // On the heap, since several threads may be hashing files at the same time.
+  std::vector<unsigned char> chunk(VORBIS_INDEX_HASH_SIZE);
+
+  size_t bytes_read = fread(chunk.data(), 1, VORBIS_INDEX_HASH_SIZE, file);
+  header->file_hash = vorbis_hash_bytes(header->file_hash, chunk.data(), bytes_read);
+
+  if(header->file_size > VORBIS_INDEX_HASH_SIZE * 2) {
+    fseek(file, -VORBIS_INDEX_HASH_SIZE, SEEK_END);
+
+    bytes_read        = fread(chunk.data(), 1, VORBIS_INDEX_HASH_SIZE, file);
+    header->file_hash = vorbis_hash_bytes(header->file_hash, chunk.data(), bytes_read);
+  }
+
+  fclose(file);
+  return true;
+}
+
+/// Loads the index of the OGG file at `path` from its sidecar, or builds it with `source` (which must 
+/// read that same file) and writes the sidecar when it is missing or out of date. Returns `true` if 
+/// the sidecar was used. 
+///
+/// Like the MP3 seek table cache, the sidecar is written to a temporary file first and then renamed, 
+/// so a crash (or a full disk) never leaves a truncated sidecar behind. The temporary name is unique 
+/// per process and per write, since several threads may be indexing the same file at the same time.
+
+static bool vorbis_index_load(const char* path, VorbisByteSource source, VorbisPageIndex* index) {
+  char index_path[1024];
+  snprintf(index_path, sizeof(index_path), "%s.idx", path);
+
+  VorbisIndexHeader key;
+  bool has_key = vorbis_get_file_key(path, &key);
+
+  FILE* file = has_key ? fopen(index_path, "rb") : nullptr;
+  if(file) {
+    VorbisIndexHeader header;
+    bool is_valid = fread(&header, sizeof(header), 1, file) == 1 && 
+                    memcmp(header.magic, "OGGI", 4) == 0 && 
+                    header.version == VORBIS_INDEX_VERSION && 
+                    header.file_size == key.file_size && 
+                    header.file_mtime == key.file_mtime && 
+                    header.file_hash == key.file_hash;
+
+    // The count comes from the file, so we make sure the sidecar is actually big enough to hold 
+    // that many pages before allocating them. A corrupt sidecar could ask for anything otherwise.
+    struct stat index_stat;
+    is_valid = is_valid && fstat(fileno(file), &index_stat) == 0 && 
+               header.pages_count <= ((unsigned long long)index_stat.st_size - sizeof(header)) / sizeof(VorbisPageEntry);
+
+    if(is_valid) {
+      index->pages.resize(header.pages_count);
+      is_valid = fread(index->pages.data(), sizeof(VorbisPageEntry), header.pages_count, file) == header.pages_count;
+    }
+
+    fclose(file);
+
+    if(is_valid) {
+      return true;
+    }
+  }
+
+  vorbis_index_build(source, index);
+
+  static std::atomic<unsigned int> temp_counter(0);
+
+  char temp_path[1100];
+  snprintf(temp_path, sizeof(temp_path), "%s.%d.%u.tmp", index_path, (int)getpid(), temp_counter.fetch_add(1));
+
+  file = has_key ? fopen(temp_path, "wb") : nullptr;
+  if(file) {
+    memcpy(key.magic, "OGGI", 4);
+    key.version     = VORBIS_INDEX_VERSION;
+    key.pages_count = index->pages.size();
+
+    bool is_written = fwrite(&key, sizeof(key), 1, file) == 1 && 
+                      fwrite(index->pages.data(), sizeof(VorbisPageEntry), index->pages.size(), file) == index->pages.size();
+    is_written      = fclose(file) == 0 && is_written;
+
+    if(is_written) {
+      rename(temp_path, index_path);
+    }
+    else {
+      remove(temp_path);
+    }
+  }
+
+  return false;
+}
+
+/// Seeks the stream so the next sample read is `sample` (in frames from the start of the file). 
+///
+/// We look for the last page that finishes _before_ the target and start decoding right at the 
+/// start of that page. The first frame after a jump never produces any samples (the decoder needs 
+/// the previous frame to overlap with), and starting one page early makes sure that frame is not 
+/// one we need. Until stb_vorbis sees a granule position, it doesn't know where it is, so 
+/// `stb_vorbis_get_sample_offset` returns `-1` and we just throw those frames away. After that, 
+/// it tells us the position right _after_ each frame, and we keep only the part from the target on.
+///
+/// That doesn't work when the target is on the first audio page (which includes seeking to 0 to 
+/// loop a sound): there's no page before it to start from, and the frames we'd throw away while 
+/// waiting for the granule position are the ones we need. But, there, we do know where we are: 
+/// decoding starts at the very beginning of the audio, so we count the samples ourselves.
+///
+/// This resets the ring buffer, so make sure nobody is calling `vorbis_stream_read` at the same time.
+
+static bool vorbis_stream_seek(VorbisStream* stream, const VorbisPageIndex* index, unsigned long long sample) {
+  auto page = std::lower_bound(index->pages.begin(), index->pages.end(), sample, 
+                              [](const VorbisPageEntry& entry, unsigned long long target) { return entry.granule_position < target; });
+
+  bool is_before_first_page = page == index->pages.begin();
+
+  stb_vorbis_flush_pushdata(stream->vorbis);
+  stream->source_offset = is_before_first_page ? stream->audio_offset : (size_t)(page - 1)->byte_offset;
+  stream->reached_end.store(false, std::memory_order_relaxed);
+  stream->read_pos.store(stream->write_pos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+  unsigned long long position = 0; // Right after the frame we just decoded
+
+  while(true) {
+    float** output; 
+    int samples;
+
+    if(!vorbis_stream_decode_frame(stream, &output, &samples)) {
+      stream->reached_end.store(true, std::memory_order_release);
+      return false;
+    }
+
+    if(is_before_first_page) {
+      position += samples;
+    }
+    else {
+      int offset = stb_vorbis_get_sample_offset(stream->vorbis);
+      if(offset < 0) {
+        continue;
+      }
+
+      position = (unsigned long long)offset;
+    }
+
+    if(position <= sample) {
+      continue;
+    }
+
+    // This frame covers [position - samples, position). Keep only what's at or after the target.
+    unsigned long long frame_start = position - samples;
+    int skip                       = sample > frame_start ? (int)(sample - frame_start) : 0;
+
+    vorbis_stream_write_frame(stream, output, skip, samples - skip);
+    return true;
+  }
+}
+
+/// By default, every `stb_vorbis` you open allocates its decoder state with `malloc`. That 
+/// is a lot of small allocations if you open and close hundreds of short voice lines per second. 
+///
+/// Instead, stb_vorbis lets us hand it a block of memory through the `stb_vorbis_alloc` struct. 
+/// It will then carve _everything_ it needs out of that block and never call `malloc` at all. 
+/// If the block is too small, opening fails with the `VORBIS_outofmem` error. Closing a stream 
+/// doesn't free anything from the block, so we can just reuse it for the next stream.
+///
+/// The pool below preallocates a fixed number of these blocks ("slots") once, and hands them out 
+/// when opening a stream. Acquiring and releasing a slot never locks and never allocates. 
+///
+/// How big does a slot need to be? `stb_vorbis_get_info` tells us how much memory a file needed: 
+/// the setup memory (which lives as long as the stream), the temporary memory needed during setup, 
+/// and the temporary memory needed while decoding. The `stb_vorbis` struct itself also lives in 
+/// the block. `vorbis_pool_measure` adds those up for a file, and you should take the worst case 
+/// over all of your assets (files with the same encoder settings need the same amount).
+
+#define VORBIS_POOL_MAX_SLOTS 256
+
+struct VorbisAllocPool {
+  char* memory; 
+  size_t slot_size; 
+  int slots_count;
+
+  std::atomic<bool> is_slot_used[VORBIS_POOL_MAX_SLOTS];
+
+  /// `overflows_count` counts streams that needed more memory than a slot has, and 
+  /// `exhausted_count` counts opens that found no free slot. Both should stay at zero. 
+  std::atomic<int> overflows_count;
+  std::atomic<int> exhausted_count;
+};
+
+/// Returns how many bytes a slot needs to decode the given OGG file, or `0` if the file could not be opened.
+
+static size_t vorbis_pool_measure(const unsigned char* data, int size) {
+  int error = 0;
+
+  stb_vorbis* vorbis = stb_vorbis_open_memory(data, size, &error, nullptr);
+  if(!vorbis) {
+    return 0;
+  }
+
+  stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+  stb_vorbis_close(vorbis);
+
+  size_t temp_size = info.setup_temp_memory_required > info.temp_memory_required ? info.setup_temp_memory_required : info.temp_memory_required;
+
+  // A bit of extra room, since stb_vorbis aligns some of its allocations.
+  return info.setup_memory_required + sizeof(stb_vorbis) + temp_size + 1024;
+}
+
+static bool vorbis_pool_init(VorbisAllocPool* pool, size_t slot_size, int slots_count) {
+  if(slots_count > VORBIS_POOL_MAX_SLOTS) {
+    return false;
+  }
+
+  // Rounding the slot size up so every slot starts nicely aligned.
+  pool->slot_size   = (slot_size + 63) & ~(size_t)63;
+  pool->slots_count = slots_count;
+  pool->memory      = (char*)malloc(pool->slot_size * slots_count);
+
+  for(int i = 0; i < slots_count; i++) {
+    pool->is_slot_used[i].store(false);
+  }
+
+  pool->overflows_count.store(0);
+  pool->exhausted_count.store(0);
+
+  return pool->memory != nullptr;
+}
+
+static void vorbis_pool_shutdown(VorbisAllocPool* pool) {
+  free(pool->memory);
+}
+
+/// Grabs a free slot and fills `out_alloc` with it. Returns `false` if every slot is in use.
+
+static bool vorbis_pool_acquire(VorbisAllocPool* pool, stb_vorbis_alloc* out_alloc) {
+  for(int i = 0; i < pool->slots_count; i++) {
+    bool expected = false; 
+
+    if(pool->is_slot_used[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      out_alloc->alloc_buffer                 = pool->memory + pool->slot_size * i;
+      out_alloc->alloc_buffer_length_in_bytes = (int)pool->slot_size;
+
+      return true;
+    }
+  }
+
+  pool->exhausted_count.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+/// Gives the slot back to the pool. `slot_ptr` can be any pointer inside the slot, such as the 
+/// `alloc_buffer` that `vorbis_pool_acquire` gave you.
+
+static void vorbis_pool_release(VorbisAllocPool* pool, const char* slot_ptr) {
+  int slot = (int)((slot_ptr - pool->memory) / pool->slot_size);
+  pool->is_slot_used[slot].store(false, std::memory_order_release);
+}
+
+/// Opens an OGG file that is already in memory using a slot from the pool. Since the `stb_vorbis` 
+/// struct itself lives inside the slot, we don't even need to remember which slot it was when closing.
+
+static stb_vorbis* vorbis_pool_open_memory(VorbisAllocPool* pool, const unsigned char* data, int size, int* error) {
+  stb_vorbis_alloc alloc; 
+  if(!vorbis_pool_acquire(pool, &alloc)) {
+    *error = VORBIS_outofmem;
+    return nullptr;
+  }
+
+  stb_vorbis* vorbis = stb_vorbis_open_memory(data, size, error, &alloc);
+  if(!vorbis) {
+    if(*error == VORBIS_outofmem) {
+      pool->overflows_count.fetch_add(1, std::memory_order_relaxed);
+      printf("WARNING: OGG stream needs more than %zu bytes of decoder memory!\n", pool->slot_size);
+    }
+
+    vorbis_pool_release(pool, alloc.alloc_buffer);
+    return nullptr;
+  }
+
+  return vorbis;
+}
+
+static void vorbis_pool_close(VorbisAllocPool* pool, stb_vorbis* vorbis) {
+  stb_vorbis_close(vorbis);
+  vorbis_pool_release(pool, (const char*)vorbis);
+}
+
+/// Preloading thousands of short sound effects one `stb_vorbis_decode_filename` at a time only 
+/// uses a single core, and ends up with thousands of separate allocations. The batch decoder 
+/// below decodes a whole list of files on all cores, and puts every decoded file into _one_ 
+/// contiguous buffer, along with a table of where each file starts.
+///
+/// It works in two passes over the list: 
+///
+///   1. The "info" pass opens each file and asks for its channels, sample rate, and length. 
+///      That's cheap, since it only reads the headers and the last page. With those, we know 
+///      exactly how big the one big buffer has to be, and where each file goes in it.
+///   2. The "decode" pass opens each file again and decodes it straight into its slice.
+///
+/// Both passes run on a small pool of threads. Each thread starts with its own share of the list, 
+/// and when it runs out, it "steals" files from the shares of the other threads. That way, a thread 
+/// that got a couple of long files doesn't hold everyone else up. 
+///
+/// Each thread also has its own scratch `stb_vorbis_alloc` buffer that it reuses for every file it 
+/// opens (see the decoder pool above for how that works), so the decoders don't touch the heap. If a 
+/// file needs more than that, it falls back to the heap and counts it in `scratch_overflows`.
+
+#define VORBIS_BATCH_SCRATCH_SIZE (512 * 1024)
+
+struct VorbisBatchEntry {
+  size_t samples_offset; // Where the file starts in `VorbisBatch.samples`, in `short`s
+  size_t frames_count;
+  int channels; 
+  int sample_rate;
+  int error; // `0` if the file was decoded successfully
+};
+
+struct VorbisBatch {
+  short* samples; // Every decoded file, one after the other. Free it with `free`.
+  size_t samples_count;
+
+  std::vector<VorbisBatchEntry> entries; // One per path, in the same order
+  std::atomic<int> scratch_overflows;
+};
+
+/// Each thread's share of the list. `next` is shared between the owner and any thieves, and 
+/// whoever bumps it first gets the task.
+
+struct VorbisBatchShare {
+  std::atomic<size_t> next; 
+  size_t end;
+};
+
+/// Runs `task(worker_index, task_index)` for every task index on `threads_count` threads.
+
+static void vorbis_batch_run(unsigned int threads_count, size_t tasks_count, const std::function<void(unsigned int, size_t)>& task) {
+  std::vector<VorbisBatchShare> shares(threads_count);
+
+  for(unsigned int i = 0; i < threads_count; i++) {
+    shares[i].next.store(tasks_count * i / threads_count);
+    shares[i].end = tasks_count * (i + 1) / threads_count;
+  }
+
+  auto worker = [&](unsigned int worker_index) {
+    // Going through our own share first, and then through everyone else's.
+    for(unsigned int i = 0; i < threads_count; i++) {
+      VorbisBatchShare& share = shares[(worker_index + i) % threads_count];
+
+      for(size_t index = share.next.fetch_add(1); index < share.end; index = share.next.fetch_add(1)) {
+        task(worker_index, index);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(unsigned int i = 1; i < threads_count; i++) {
+    threads.emplace_back(worker, i);
+  }
+
+  worker(0); // The calling thread helps out as well
+
+  for(std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Opens a file with the worker's scratch buffer, falling back to the heap if it's too small.
+
+static stb_vorbis* vorbis_batch_open(VorbisBatch* batch, const char* path, char* scratch, int* error) {
+  stb_vorbis_alloc alloc = {scratch, VORBIS_BATCH_SCRATCH_SIZE};
+
+  stb_vorbis* vorbis = stb_vorbis_open_filename(path, error, &alloc);
+  if(!vorbis && *error == VORBIS_outofmem) {
+    batch->scratch_overflows.fetch_add(1, std::memory_order_relaxed);
+    vorbis = stb_vorbis_open_filename(path, error, nullptr);
+  }
+
+  // stb_vorbis only writes the error on failure, so clear the one left over from the first try.
+  if(vorbis) {
+    *error = 0;
+  }
+
+  return vorbis;
+}
+
+/// Decodes every file in `paths` into `batch`. Files that fail to load get a non-zero `error` 
+/// and `0` frames, but don't stop the rest of the batch. Returns `false` (with nothing left to 
+/// free in `batch`) only if the one big allocation fails.
+
+static bool vorbis_batch_decode(VorbisBatch* batch, const char* const* paths, size_t paths_count, unsigned int threads_count) {
+  batch->entries.assign(paths_count, VorbisBatchEntry{});
+  batch->scratch_overflows.store(0);
+
+  std::vector<char> scratch_buffers((size_t)threads_count * VORBIS_BATCH_SCRATCH_SIZE);
+
+  /// The info pass.
+
+  vorbis_batch_run(threads_count, paths_count, [&](unsigned int worker_index, size_t index) {
+    VorbisBatchEntry& entry = batch->entries[index];
+    char* scratch           = scratch_buffers.data() + (size_t)worker_index * VORBIS_BATCH_SCRATCH_SIZE;
+
+    stb_vorbis* vorbis = vorbis_batch_open(batch, paths[index], scratch, &entry.error);
+    if(!vorbis) {
+      return;
+    }
+
+    stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+    entry.channels       = info.channels;
+    entry.sample_rate    = info.sample_rate;
+    entry.frames_count   = stb_vorbis_stream_length_in_samples(vorbis);
+
+    stb_vorbis_close(vorbis);
+  });
+
+  /// Laying out every file one after the other, and making the one big allocation.
+
+  batch->samples_count = 0;
+  for(VorbisBatchEntry& entry : batch->entries) {
+    entry.samples_offset  = batch->samples_count;
+    batch->samples_count += entry.frames_count * entry.channels;
+  }
+
+  batch->samples = (short*)calloc(batch->samples_count, sizeof(short));
+  if(!batch->samples && batch->samples_count > 0) {
+    batch->entries.clear();
+    batch->samples_count = 0;
+    return false;
+  }
+
+  /// The decode pass. `stb_vorbis_get_samples_short_interleaved` writes interleaved frames and 
+  /// returns how many frames it decoded, or `0` once the file is over.
+
+  vorbis_batch_run(threads_count, paths_count, [&](unsigned int worker_index, size_t index) {
+    VorbisBatchEntry& entry = batch->entries[index];
+    char* scratch           = scratch_buffers.data() + (size_t)worker_index * VORBIS_BATCH_SCRATCH_SIZE;
+
+    if(entry.error != 0 || entry.frames_count == 0) {
+      return;
+    }
+
+    stb_vorbis* vorbis = vorbis_batch_open(batch, paths[index], scratch, &entry.error);
+    if(!vorbis) {
+      entry.frames_count = 0;
+      return;
+    }
+
+    short* out_samples  = batch->samples + entry.samples_offset;
+    size_t frames_done  = 0;
+
+    while(frames_done < entry.frames_count) {
+      int frames_read = stb_vorbis_get_samples_short_interleaved(vorbis, 
+                                                                 entry.channels, 
+                                                                 out_samples + frames_done * entry.channels, 
+                                                                 (int)((entry.frames_count - frames_done) * entry.channels));
+      if(frames_read == 0) {
+        break;
+      }
+
+      frames_done += frames_read;
+    }
+
+    entry.frames_count = frames_done; // In case the file turned out a bit shorter than advertised
+    stb_vorbis_close(vorbis);
+  });
+
+  return true;
+}
+
+/// Reads a whole file into a buffer allocated with `malloc`. Just a small helper for the examples below.
+
+static unsigned char* read_file_in_bytes(const char* path, int* out_size) {
+  FILE* file = fopen(path, "rb");
+  if(!file) {
+    return nullptr;
+  }
+
+  fseek(file, 0, SEEK_END);
+  *out_size = (int)ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  unsigned char* data = (unsigned char*)malloc(*out_size);
+  *out_size           = (int)fread(data, 1, *out_size, file);
+
+  fclose(file);
+  return data;
+}
+
 int main() {
   /// In order to use stb_vorbis, you'll need to call the function below to 
   /// load an `stb_vorbis` struct from a filename. The function expects a 
@@ -100,4 +955,221 @@ int main() {
   /// Always remember to de-initialize stb_vorbis when you're done with it. 
   
   stb_vorbis_close(vorbis);
+
+  /// Now, let's stream an OGG file with the pushdata stream from above. Here we use the file 
+  /// byte source, but you can swap it with a `VorbisMemorySource` pointing into a mapped file or 
+  /// an archive entry and nothing else changes. 
+  ///
+  /// In a real program, `vorbis_stream_fill` would run on a decoding thread (or in your 
+  /// update loop), and `vorbis_stream_read` would be called from the audio callback. Here we 
+  /// just do both on the same thread, one after the other.
+  ///
+  /// Both structs are a bit big to live on the stack, so we allocate them.
+
+  VorbisFileSource* file_source = new VorbisFileSource{};
+  file_source->file             = fopen("path/to/audio.ogg", "rb");
+
+  if(!file_source->file) {
+    printf("Failed to open OGG file!\n");
+    return -1;
+  }
+
+  VorbisByteSource source = {file_source, vorbis_file_source_peek};
+  VorbisStream* stream    = new VorbisStream;
+
+  if(!vorbis_stream_open(stream, source, nullptr)) {
+    printf("Failed to open OGG stream!\n");
+    return -1;
+  }
+
+  float callback_buffer[512 * 8]; // 512 frames of up to 8 channels
+  size_t total_frames = 0;
+
+  while(!vorbis_stream_is_finished(stream)) {
+    vorbis_stream_fill(stream);
+    total_frames += vorbis_stream_read(stream, callback_buffer, 512);
+  }
+
+  printf("Streamed %zu frames using %zu bytes of stream memory\n", total_frames, sizeof(VorbisStream) + sizeof(VorbisFileSource));
+
+  vorbis_stream_close(stream);
+
+  fclose(file_source->file);
+  delete file_source;
+
+  /// The same file again, but this time from memory. Only the byte source changes. Here the whole 
+  /// file is read up front, but `data` could just as well point into a mapped file or an archive.
+
+  int memory_size = 0;
+  unsigned char* memory_data = read_file_in_bytes("path/to/audio.ogg", &memory_size);
+
+  VorbisMemorySource memory_source = {memory_data, memory_data ? (size_t)memory_size : 0};
+  VorbisByteSource memory_bytes    = {&memory_source, vorbis_memory_source_peek};
+
+  if(memory_data && vorbis_stream_open(stream, memory_bytes, nullptr)) {
+    size_t memory_frames = 0;
+
+    while(!vorbis_stream_is_finished(stream)) {
+      vorbis_stream_fill(stream);
+      memory_frames += vorbis_stream_read(stream, callback_buffer, 512);
+    }
+
+    printf("Streamed %zu frames from memory (%s)\n", memory_frames, memory_frames == total_frames ? "same as the file" : "MISMATCH");
+    vorbis_stream_close(stream);
+  }
+
+  free(memory_data);
+  delete stream;
+
+  /// And here is the decoder pool from above. First, we measure how much memory our voice lines 
+  /// need, then we create a pool of 64 slots, and then we open and close a voice line a few 
+  /// hundred times. After `vorbis_pool_init`, none of this touches the heap.
+  ///
+  /// The voice line is loaded into memory up front (think of a sound bank), so opening it 
+  /// doesn't need to go through stdio either.
+
+  int voice_size = 0; 
+  unsigned char* voice_data = read_file_in_bytes("path/to/voice_line.ogg", &voice_size);
+
+  if(!voice_data) {
+    printf("Failed to read OGG file!\n");
+    return -1;
+  }
+
+  VorbisAllocPool* pool = new VorbisAllocPool;
+  if(!vorbis_pool_init(pool, vorbis_pool_measure(voice_data, voice_size), 64)) {
+    printf("Failed to create the decoder pool!\n");
+    return -1;
+  }
+
+  short voice_samples[1024];
+
+  for(int i = 0; i < 500; i++) {
+    int voice_error = 0;
+
+    stb_vorbis* voice = vorbis_pool_open_memory(pool, voice_data, voice_size, &voice_error);
+    if(!voice) {
+      printf("Failed to open voice line! %i\n", voice_error);
+      continue;
+    }
+
+    stb_vorbis_get_samples_short_interleaved(voice, 2, voice_samples, 1024);
+    vorbis_pool_close(pool, voice);
+  }
+
+  printf("POOL: %i slots of %zu bytes, %i overflows, %i exhausted\n", 
+         pool->slots_count, pool->slot_size, pool->overflows_count.load(), pool->exhausted_count.load());
+
+  vorbis_pool_shutdown(pool);
+  delete pool;
+
+  free(voice_data);
+
+  /// Finally, let's compare the seek latency of `stb_vorbis_seek` against the page index from above. 
+  /// We seek to the same 200 scrambled positions with both, and print a few percentiles. The first 
+  /// run builds the index sidecar, so run the sample twice to also skip the index build.
+
+  const int seeks_count = 200;
+  std::vector<double> plain_seeks, indexed_seeks;
+
+  stb_vorbis* seek_vorbis = stb_vorbis_open_filename("path/to/audio.ogg", &error_code, nullptr);
+  if(!seek_vorbis) {
+    printf("Failed to load OGG file! %i\n", error_code);
+    return -1;
+  }
+
+  unsigned int length_in_samples = stb_vorbis_stream_length_in_samples(seek_vorbis);
+
+  for(int i = 0; i < seeks_count; i++) {
+    unsigned int target = (unsigned int)((unsigned long long)length_in_samples * ((i * 67) % seeks_count) / seeks_count);
+
+    auto start = std::chrono::steady_clock::now();
+    stb_vorbis_seek(seek_vorbis, target);
+    plain_seeks.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  stb_vorbis_close(seek_vorbis);
+
+  VorbisFileSource* index_file_source = new VorbisFileSource{};
+  index_file_source->file             = fopen("path/to/audio.ogg", "rb");
+
+  VorbisByteSource index_source = {index_file_source, vorbis_file_source_peek};
+  VorbisStream* indexed_stream  = new VorbisStream;
+
+  if(!index_file_source->file || !vorbis_stream_open(indexed_stream, index_source, nullptr)) {
+    printf("Failed to open OGG stream!\n");
+    return -1;
+  }
+
+  VorbisPageIndex page_index;
+  bool is_index_cached = vorbis_index_load("path/to/audio.ogg", index_source, &page_index);
+
+  for(int i = 0; i < seeks_count; i++) {
+    unsigned int target = (unsigned int)((unsigned long long)length_in_samples * ((i * 67) % seeks_count) / seeks_count);
+
+    auto start = std::chrono::steady_clock::now();
+    vorbis_stream_seek(indexed_stream, &page_index, target);
+    indexed_seeks.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  vorbis_stream_close(indexed_stream);
+  delete indexed_stream;
+
+  fclose(index_file_source->file);
+  delete index_file_source;
+
+  std::sort(plain_seeks.begin(), plain_seeks.end());
+  std::sort(indexed_seeks.begin(), indexed_seeks.end());
+
+  printf("SEEK (stb_vorbis_seek): p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n", 
+         plain_seeks[seeks_count / 2], plain_seeks[seeks_count * 9 / 10], plain_seeks[seeks_count * 99 / 100], plain_seeks.back());
+  printf("SEEK (page index, %s): p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n", 
+         is_index_cached ? "cached" : "built", 
+         indexed_seeks[seeks_count / 2], indexed_seeks[seeks_count * 9 / 10], indexed_seeks[seeks_count * 99 / 100], indexed_seeks.back());
+
+  /// And here is the batch decoder from above. We decode the same list of sound effects with 
+  /// `stb_vorbis_decode_filename`, one at a time, and then with the batch decoder using 1 up to 
+  /// as many threads as the machine has.
+
+  const char* sfx_paths[] = {
+    "path/to/footstep.ogg",
+    "path/to/gunshot.ogg",
+    "path/to/explosion.ogg",
+    "path/to/door.ogg",
+  };
+  const size_t sfx_count = sizeof(sfx_paths) / sizeof(sfx_paths[0]);
+
+  auto serial_start = std::chrono::steady_clock::now();
+
+  for(size_t i = 0; i < sfx_count; i++) {
+    int sfx_channels, sfx_sample_rate; 
+    short* sfx_samples = nullptr;
+
+    if(stb_vorbis_decode_filename(sfx_paths[i], &sfx_channels, &sfx_sample_rate, &sfx_samples) != -1) {
+      free(sfx_samples);
+    }
+  }
+
+  double serial_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - serial_start).count();
+  printf("BATCH (serial stb_vorbis_decode_filename): %.2f ms\n", serial_ms);
+
+  unsigned int max_threads = std::thread::hardware_concurrency();
+  max_threads              = max_threads == 0 ? 1 : max_threads;
+
+  for(unsigned int threads_count = 1; threads_count <= max_threads; threads_count++) {
+    VorbisBatch batch;
+
+    auto start = std::chrono::steady_clock::now();
+    if(!vorbis_batch_decode(&batch, sfx_paths, sfx_count, threads_count)) {
+      printf("ERROR: Could not allocate the batch's samples!\n");
+      return -1;
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("BATCH (%2u threads): %.2f ms, %.2fx speedup, %zu samples in one buffer, %i scratch overflows\n", 
+           threads_count, elapsed_ms, serial_ms / elapsed_ms, batch.samples_count, batch.scratch_overflows.load());
+
+    // Each file lives at `batch.samples + entry.samples_offset`.
+    free(batch.samples);
+  }
 }